@@ -0,0 +1,74 @@
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "chip8.h"
+#include "sdl.h"
+
+namespace {
+
+using HeadlessChip8 = Chip8<EmptyGfx, EmptyInput, EmptyAudio>;
+
+// Register arithmetic in an endless loop.
+const std::vector<uint8_t> alu_loop{
+    0x60, 0x01,  // LD V0,01
+    0x61, 0x02,  // LD V1,02
+    0x80, 0x14,  // ADD V0,V1
+    0x81, 0x03,  // XOR V1,V0
+    0x72, 0x01,  // ADD V2,01
+    0x32, 0x00,  // SE V2,00
+    0x12, 0x04,  // JP 0x204
+    0x12, 0x00,  // JP 0x200
+};
+
+void BM_ExecuteUncached(benchmark::State& state) {
+  EmptyGfx gfx;
+  EmptyInput input;
+  EmptyAudio audio;
+  HeadlessChip8 chip8{gfx, input, audio};
+  chip8.load(alu_loop);
+
+  for (auto _ : state) {
+    chip8.execute_uncached();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_ExecuteCycle(benchmark::State& state) {
+  EmptyGfx gfx;
+  EmptyInput input;
+  EmptyAudio audio;
+  HeadlessChip8 chip8{gfx, input, audio};
+  chip8.load(alu_loop);
+
+  for (auto _ : state) {
+    chip8.execute_cycle();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Long session with the selected engine, in batches of 1000 instructions.
+void BM_Run(benchmark::State& state) {
+  EmptyGfx gfx;
+  EmptyInput input;
+  EmptyAudio audio;
+  HeadlessChip8 chip8{gfx, input, audio};
+  chip8.load(alu_loop);
+  chip8.set_engine(static_cast<Engine>(state.range(0)));
+
+  const std::size_t batch{1000};
+  for (auto _ : state) {
+    chip8.run(batch);
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * batch));
+  state.SetLabel(HeadlessChip8::threaded_dispatch ? "computed goto" : "switch");
+}
+
+}  // namespace
+
+BENCHMARK(BM_ExecuteUncached);
+BENCHMARK(BM_ExecuteCycle);
+BENCHMARK(BM_Run)
+    ->ArgName("engine")
+    ->Arg(static_cast<int>(Engine::interpreter))
+    ->Arg(static_cast<int>(Engine::block));
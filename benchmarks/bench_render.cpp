@@ -0,0 +1,38 @@
+#include <benchmark/benchmark.h>
+
+#include "sdl.h"
+
+namespace {
+
+// Fill every other pixel, so that both colors are drawn.
+template <typename Gfx>
+void draw_pattern(Gfx& gfx, bool phase) {
+  for (int y = 0; y < 32; ++y) {
+    for (int x = 0; x < 64; ++x) {
+      gfx.set_pixel(x, y, ((x + y) % 2 == 0) == phase);
+    }
+  }
+}
+
+// Full-frame render of a backend. The dummy video driver renders to an offscreen
+// surface, so no window is shown.
+template <typename Gfx>
+void BM_RenderFullFrame(benchmark::State& state) {
+  SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+  Gfx gfx{1024, 512};
+  bool phase{false};
+  for (auto _ : state) {
+    state.PauseTiming();
+    draw_pattern(gfx, phase);
+    phase = !phase;
+    state.ResumeTiming();
+
+    gfx.present();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+}  // namespace
+
+BENCHMARK_TEMPLATE(BM_RenderFullFrame, SdlGfx)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_RenderFullFrame, SdlTextureGfx)->Unit(benchmark::kMicrosecond);
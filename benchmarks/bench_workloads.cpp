@@ -0,0 +1,356 @@
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "chip8.h"
+#include "lockstep.h"
+#include "memory.h"
+#include "rewind.h"
+#include "rom_archive.h"
+#include "sdl.h"
+#include "vec_env.h"
+
+namespace {
+
+using HeadlessChip8 = Chip8<EmptyGfx, EmptyInput, EmptyAudio>;
+
+// Font glyphs drawn across the screen.
+const std::vector<uint8_t> sprite_loop{
+    0x60, 0x00,  // LD V0,00
+    0x61, 0x00,  // LD V1,00
+    0xF2, 0x29,  // LD F,V2
+    0xD0, 0x15,  // DRW V0,V1,5
+    0x70, 0x05,  // ADD V0,05
+    0x71, 0x03,  // ADD V1,03
+    0x72, 0x01,  // ADD V2,01
+    0x12, 0x04,  // JP 0x204
+};
+
+// All registers stored to and loaded from memory.
+const std::vector<uint8_t> memory_loop{
+    0xA3, 0x00,  // LD I,0x300
+    0xFF, 0x55,  // LD [I],VF
+    0xA3, 0x00,  // LD I,0x300
+    0xFF, 0x65,  // LD VF,[I]
+    0x70, 0x01,  // ADD V0,01
+    0x12, 0x00,  // JP 0x200
+};
+
+// Random numbers with different masks.
+const std::vector<uint8_t> random_loop{
+    0xC0, 0xFF,  // RND V0,FF
+    0xC1, 0x0F,  // RND V1,0F
+    0xC2, 0xF0,  // RND V2,F0
+    0x12, 0x00,  // JP 0x200
+};
+
+// Sprite drawn once a second, waiting on the delay timer in between.
+const std::vector<uint8_t> timer_wait_loop{
+    0x60, 0x3C,  // LD V0,3C
+    0xF0, 0x15,  // LD DT,V0
+    0xD1, 0x15,  // DRW V1,V1,5
+    0xF2, 0x07,  // LD V2,DT
+    0x32, 0x00,  // SE V2,00
+    0x12, 0x06,  // JP 0x206
+    0x12, 0x00,  // JP 0x200
+};
+
+// Random sprites, lanes of a lockstep machine briefly diverging on the skip.
+const std::vector<uint8_t> lockstep_loop{
+    0xC0, 0xFF,  // RND V0,FF
+    0xC1, 0x1F,  // RND V1,1F
+    0x80, 0x14,  // ADD V0,V1
+    0xF2, 0x29,  // LD F,V2
+    0xD0, 0x15,  // DRW V0,V1,5
+    0x72, 0x01,  // ADD V2,01
+    0x30, 0x80,  // SE V0,80
+    0x73, 0x01,  // ADD V3,01
+    0x12, 0x00,  // JP 0x200
+};
+
+// Arithmetic on random values, lanes of a lockstep machine briefly diverging
+// on the skip.
+const std::vector<uint8_t> alu_loop{
+    0xC0, 0xFF,  // RND V0,FF
+    0x70, 0x01,  // ADD V0,01
+    0x81, 0x04,  // ADD V1,V0
+    0x82, 0x13,  // XOR V2,V1
+    0x83, 0x26,  // SHR V3,V2
+    0x84, 0x35,  // SUB V4,V3
+    0x65, 0x07,  // LD V5,07
+    0x30, 0x80,  // SE V0,80
+    0x76, 0x01,  // ADD V6,01
+    0x12, 0x02,  // JP 0x202
+};
+
+// Machines run by the lockstep benchmarks.
+const std::size_t machines{64};
+
+// Run a workload in batches of 1000 instructions with the engine given as argument.
+template <typename Memory = memory::Checked>
+void run_workload(benchmark::State& state, const std::vector<uint8_t>& game) {
+  EmptyGfx gfx;
+  EmptyInput input;
+  EmptyAudio audio;
+  Chip8<EmptyGfx, EmptyInput, EmptyAudio, quirks::CosmacVip, NullProfiler, Memory> chip8{gfx, input, audio};
+  chip8.load(game);
+  chip8.set_engine(static_cast<Engine>(state.range(0)));
+
+  const std::size_t batch{1000};
+  for (auto _ : state) {
+    chip8.run(batch);
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * batch));
+}
+
+void BM_Sprites(benchmark::State& state) { run_workload(state, sprite_loop); }
+
+void BM_Memory(benchmark::State& state) { run_workload(state, memory_loop); }
+
+void BM_Random(benchmark::State& state) { run_workload(state, random_loop); }
+
+void BM_SpritesUnchecked(benchmark::State& state) { run_workload<memory::Unchecked>(state, sprite_loop); }
+
+void BM_MemoryUnchecked(benchmark::State& state) { run_workload<memory::Unchecked>(state, memory_loop); }
+
+void BM_SpritesCopyOnWrite(benchmark::State& state) { run_workload<memory::CopyOnWrite>(state, sprite_loop); }
+
+void BM_MemoryCopyOnWrite(benchmark::State& state) { run_workload<memory::CopyOnWrite>(state, memory_loop); }
+
+// Frames of 10 instructions of a game waiting on the delay timer, with idle
+// skip as argument.
+void BM_TimerWait(benchmark::State& state) {
+  EmptyGfx gfx;
+  EmptyInput input;
+  EmptyAudio audio;
+  HeadlessChip8 chip8{gfx, input, audio};
+  chip8.load(timer_wait_loop);
+  chip8.set_idle_skip(state.range(0) != 0);
+
+  const std::size_t frames{60};
+  const std::size_t cycles_per_frame{10};
+  for (auto _ : state) {
+    for (std::size_t i = 0; i < frames; ++i) {
+      chip8.step_frame(cycles_per_frame);
+    }
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * frames * cycles_per_frame));
+  state.counters["skipped"] = static_cast<double>(chip8.skipped_cycles()) / static_cast<double>(chip8.cycles());
+}
+
+// Forks of a running machine, each run for 10 instructions, as a tree search
+// expands a node. Reports memory per fork.
+template <typename Memory>
+void run_forks(benchmark::State& state) {
+  EmptyGfx gfx;
+  EmptyInput input;
+  EmptyAudio audio;
+  Chip8<EmptyGfx, EmptyInput, EmptyAudio, quirks::CosmacVip, NullProfiler, Memory> chip8{gfx, input, audio};
+  chip8.load(memory_loop);
+  chip8.run(1000);
+
+  EmptyGfx fork_gfx;
+  std::size_t bytes{0};
+  for (auto _ : state) {
+    auto fork{chip8.fork(fork_gfx, input, audio)};
+    fork.run(10);
+    bytes = fork.unshared_bytes();
+    benchmark::DoNotOptimize(fork);
+  }
+  state.counters["bytes_per_fork"] = static_cast<double>(bytes);
+}
+
+void BM_Fork(benchmark::State& state) { run_forks<memory::Checked>(state); }
+
+void BM_ForkCopyOnWrite(benchmark::State& state) { run_forks<memory::CopyOnWrite>(state); }
+
+// As many separate machines as lanes of the lockstep benchmarks.
+void run_machines(benchmark::State& state, const std::vector<uint8_t>& game) {
+  EmptyGfx gfx;
+  EmptyInput input;
+  EmptyAudio audio;
+  std::vector<std::unique_ptr<HeadlessChip8>> chip8s;
+  for (std::size_t i = 0; i < machines; ++i) {
+    chip8s.push_back(std::make_unique<HeadlessChip8>(gfx, input, audio));
+    chip8s.back()->load(game);
+    chip8s.back()->seed(i);
+  }
+
+  const std::size_t batch{1000};
+  for (auto _ : state) {
+    for (auto& chip8 : chip8s) {
+      chip8->run(batch);
+    }
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * batch * machines));
+}
+
+// Many machines in lockstep.
+void run_lockstep(benchmark::State& state, const std::vector<uint8_t>& game) {
+  auto lockstep{std::make_unique<Lockstep<machines>>()};
+  lockstep->load(game);
+  for (std::size_t i = 0; i < machines; ++i) {
+    lockstep->seed(i, i);
+  }
+
+  const std::size_t batch{1000};
+  for (auto _ : state) {
+    lockstep->run(batch);
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * batch * machines));
+}
+
+void BM_ScalarMachines(benchmark::State& state) { run_machines(state, lockstep_loop); }
+
+void BM_Lockstep(benchmark::State& state) { run_lockstep(state, lockstep_loop); }
+
+void BM_ScalarMachinesAlu(benchmark::State& state) { run_machines(state, alu_loop); }
+
+void BM_LockstepAlu(benchmark::State& state) { run_lockstep(state, alu_loop); }
+
+// Steps of a vectorized environment, 4 frames of 10 cycles each.
+void BM_VecEnv(benchmark::State& state) {
+  VecEnv env{sprite_loop, {.envs = machines}};
+  struct alignas(VecEnv::observation_alignment) Observation {
+    std::array<uint8_t, VecEnv::observation_size> pixels;
+  };
+  std::vector<Observation> observations(env.size());
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  std::span<uint8_t> buffer{reinterpret_cast<uint8_t*>(observations.data()), env.size() * VecEnv::observation_size};
+  std::vector<uint16_t> actions(env.size());
+  std::vector<float> rewards(env.size());
+  std::vector<uint8_t> done(env.size());
+
+  env.reset(0, buffer);
+  for (auto _ : state) {
+    env.step(actions, buffer, rewards, done);
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * env.size()));
+  state.counters["steps_per_second"] = env.steps_per_second();
+}
+
+// Snapshot and restore of a running machine.
+void BM_SnapshotRestore(benchmark::State& state) {
+  EmptyGfx gfx;
+  EmptyInput input;
+  EmptyAudio audio;
+  HeadlessChip8 chip8{gfx, input, audio};
+  chip8.load(sprite_loop);
+  chip8.run(1000);
+
+  HeadlessChip8::Snapshot snapshot;
+  for (auto _ : state) {
+    chip8.snapshot(snapshot);
+    chip8.restore(snapshot);
+    benchmark::DoNotOptimize(snapshot);
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * sizeof(snapshot)));
+}
+
+// Recording a frame of the sprite workload into rewind history.
+void BM_RewindPush(benchmark::State& state) {
+  EmptyGfx gfx;
+  EmptyInput input;
+  EmptyAudio audio;
+  HeadlessChip8 chip8{gfx, input, audio};
+  chip8.load(sprite_loop);
+
+  Rewind<HeadlessChip8::Snapshot> rewind{300 * 60, 64 << 20};
+  HeadlessChip8::Snapshot snapshot;
+  for (auto _ : state) {
+    state.PauseTiming();
+    chip8.run(10);
+    chip8.snapshot(snapshot);
+    state.ResumeTiming();
+    rewind.push(snapshot);
+  }
+  state.counters["bytes_per_frame"] =
+      static_cast<double>(rewind.stats().bytes) / static_cast<double>(rewind.stats().frames);
+}
+
+// Game startup from a ROM file.
+void BM_LoadGameFile(benchmark::State& state) {
+  auto path{std::filesystem::temp_directory_path() / "chip8_bench.ch8"};
+  {
+    std::ofstream file{path, std::ios::binary};
+    file.write(reinterpret_cast<const char*>(sprite_loop.data()), static_cast<std::streamsize>(sprite_loop.size()));
+  }
+
+  EmptyGfx gfx;
+  EmptyInput input;
+  EmptyAudio audio;
+  HeadlessChip8 chip8{gfx, input, audio};
+  for (auto _ : state) {
+    chip8.load(load_game(path.string()));
+  }
+  std::filesystem::remove(path);
+}
+
+// Game startup from a mapped ROM archive of 10000 ROMs.
+void BM_LoadGameArchive(benchmark::State& state) {
+  auto path{std::filesystem::temp_directory_path() / "chip8_bench.c8a"};
+  std::vector<std::vector<uint8_t>> roms;
+  for (int i = 0; i < 10000; ++i) {
+    auto rom{sprite_loop};
+    rom.push_back(static_cast<uint8_t>(i));
+    rom.push_back(static_cast<uint8_t>(i >> 8));
+    roms.push_back(rom);
+  }
+  {
+    std::ofstream file{path, std::ios::binary};
+    write_rom_archive(file, roms);
+  }
+
+  RomArchive archive{path.string()};
+  const auto hash{fnv1a(roms.at(1234))};
+  EmptyGfx gfx;
+  EmptyInput input;
+  EmptyAudio audio;
+  HeadlessChip8 chip8{gfx, input, audio};
+  for (auto _ : state) {
+    chip8.load(*archive.find(hash));
+  }
+  std::filesystem::remove(path);
+}
+
+}  // namespace
+
+BENCHMARK(BM_Sprites)
+    ->ArgName("engine")
+    ->Arg(static_cast<int>(Engine::interpreter))
+    ->Arg(static_cast<int>(Engine::block));
+BENCHMARK(BM_Memory)
+    ->ArgName("engine")
+    ->Arg(static_cast<int>(Engine::interpreter))
+    ->Arg(static_cast<int>(Engine::block));
+BENCHMARK(BM_Random)
+    ->ArgName("engine")
+    ->Arg(static_cast<int>(Engine::interpreter))
+    ->Arg(static_cast<int>(Engine::block));
+BENCHMARK(BM_SpritesUnchecked)
+    ->ArgName("engine")
+    ->Arg(static_cast<int>(Engine::interpreter))
+    ->Arg(static_cast<int>(Engine::block));
+BENCHMARK(BM_MemoryUnchecked)
+    ->ArgName("engine")
+    ->Arg(static_cast<int>(Engine::interpreter))
+    ->Arg(static_cast<int>(Engine::block));
+BENCHMARK(BM_SpritesCopyOnWrite)->ArgName("engine")->Arg(static_cast<int>(Engine::interpreter));
+BENCHMARK(BM_MemoryCopyOnWrite)->ArgName("engine")->Arg(static_cast<int>(Engine::interpreter));
+BENCHMARK(BM_TimerWait)->ArgName("idle_skip")->Arg(0)->Arg(1);
+BENCHMARK(BM_Fork);
+BENCHMARK(BM_ForkCopyOnWrite);
+BENCHMARK(BM_ScalarMachines);
+BENCHMARK(BM_Lockstep);
+BENCHMARK(BM_ScalarMachinesAlu);
+BENCHMARK(BM_LockstepAlu);
+BENCHMARK(BM_VecEnv)->UseRealTime();
+BENCHMARK(BM_SnapshotRestore);
+BENCHMARK(BM_RewindPush);
+BENCHMARK(BM_LoadGameFile);
+BENCHMARK(BM_LoadGameArchive);
@@ -9,10 +9,12 @@ class Chip8Conan(ConanFile):
     settings = "os", "compiler", "build_type", "arch"
     generators = "CMakeDeps", "CMakeToolchain"
     options = {
-        "testing": [True, False]
+        "testing": [True, False],
+        "benchmarking": [True, False]
     }
     default_options = {
-        "testing": False
+        "testing": False,
+        "benchmarking": False
     }
 
     def requirements(self):
@@ -20,6 +22,8 @@ class Chip8Conan(ConanFile):
         self.requires('sdl/2.0.20')
         if self.options.testing:
             self.requires('gtest/1.11.0')
+        if self.options.benchmarking:
+            self.requires('benchmark/1.6.1')
 
     def configure(self):
         self.options['sdl'].wayland = False
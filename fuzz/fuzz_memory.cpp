@@ -0,0 +1,102 @@
+// Differential fuzzer of memory policies. Runs random ROMs on a checked and an
+// unchecked machine in lockstep and aborts if their state differs before the
+// first fault, or if they disagree on when it happens.
+//
+// Input: quirk profile and engine, key mask, seed, then the ROM.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <span>
+
+#include "chip8.h"
+#include "memory.h"
+#include "quirks.h"
+#include "sdl.h"
+
+namespace {
+
+const std::size_t header_size{4};
+const std::size_t max_cycles{2000};
+const std::size_t cycles_per_frame{10};
+
+void check(bool condition) {
+  if (!condition) {
+    std::abort();
+  }
+}
+
+template <typename Quirks>
+void run(uint8_t flags, uint16_t keys, uint8_t seed, std::span<const uint8_t> rom) {
+  EmptyGfx checked_gfx;
+  EmptyGfx unchecked_gfx;
+  EmptyInput input;
+  EmptyAudio audio;
+  for (int key = 0; key < 16; ++key) {
+    input.set_key_state(key, (keys >> key & 1U) != 0);
+  }
+
+  Chip8<EmptyGfx, EmptyInput, EmptyAudio, Quirks, NullProfiler, memory::Checked> checked{checked_gfx, input, audio};
+  Chip8<EmptyGfx, EmptyInput, EmptyAudio, Quirks, NullProfiler, memory::Unchecked> unchecked{unchecked_gfx, input,
+                                                                                             audio};
+  bool trapped{false};
+  unchecked.set_trap([&](memory::Fault /*fault*/, uint16_t /*pc*/) { trapped = true; });
+
+  const auto engine{(flags & 0b100) != 0 ? Engine::block : Engine::interpreter};
+  checked.load(rom);
+  checked.set_engine(engine);
+  checked.seed(seed);
+  unchecked.load(rom);
+  unchecked.set_engine(engine);
+  unchecked.seed(seed);
+
+  for (std::size_t cycle = 1; cycle <= max_cycles; ++cycle) {
+    bool faulted{false};
+    try {
+      checked.run(1);
+    } catch (const std::exception&) {
+      faulted = true;
+    }
+    unchecked.run(1);
+
+    check(faulted == trapped);
+    if (faulted) {
+      return;
+    }
+    check(checked.snapshot() == unchecked.snapshot());
+
+    if (cycle % cycles_per_frame == 0) {
+      checked.update_timers();
+      unchecked.update_timers();
+    }
+  }
+}
+
+}  // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, std::size_t size) {
+  if (size < header_size || size - header_size > 0x1000 - 0x200) {
+    return 0;
+  }
+  auto flags{data[0]};
+  auto keys{static_cast<uint16_t>(data[1] | data[2] << 8)};
+  auto seed{data[3]};
+  std::span<const uint8_t> rom{data + header_size, size - header_size};
+
+  switch (flags & 0b11) {
+    case 1: {
+      run<quirks::SuperChip>(flags, keys, seed, rom);
+      break;
+    }
+    case 2: {
+      run<quirks::XoChip>(flags, keys, seed, rom);
+      break;
+    }
+    default: {
+      run<quirks::CosmacVip>(flags, keys, seed, rom);
+      break;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,285 @@
+#include <CLI/CLI.hpp>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "chip8.h"
+#include "game.h"
+#include "memory.h"
+#include "movie.h"
+#include "quirks.h"
+#include "rom_archive.h"
+#include "sdl.h"
+#include "thread_pool.h"
+
+// Runs ROMs headlessly on all cores: every combination of ROM, seed and movie
+// is a job, bounded by frame and cycle count. Prints one CSV line per job.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  std::vector<std::string> roms{};
+  // ROM archive to take ROMs from, and hashes of the ROMs in it, all if none given.
+  std::string archive{};
+  std::vector<std::string> archive_roms{};
+  std::vector<uint64_t> seeds{};
+  std::vector<std::string> movies{};
+  // Frames run per job.
+  int64_t frames{600};
+  // Cycles run per job at most, 0 for no limit.
+  int64_t cycles{0};
+  int64_t cycles_per_frame{10};
+  int64_t threads{0};
+  std::string engine{"interpreter"};
+  std::string quirks{"vip"};
+  // Run wait loops instead of skipping them.
+  bool no_idle_skip{false};
+};
+
+struct Job {
+  std::size_t rom;
+  // Seed of the random number generator, movie's or default if not given.
+  std::optional<uint64_t> seed;
+  // Index of movie to take key presses from, none if not given.
+  std::optional<std::size_t> movie;
+};
+
+struct Result {
+  uint64_t frames{0};
+  uint64_t cycles{0};
+  // Cycles skipped in wait loops.
+  uint64_t skipped{0};
+  // FNV-1a hash of the final framebuffer rows.
+  uint64_t framebuffer_hash{0};
+  std::chrono::nanoseconds wall{0};
+  // What the machine threw, if it stopped early.
+  std::string error{};
+};
+
+// Read-only inputs shared by all jobs.
+struct Batch {
+  const Options& options;
+  // Name printed for every ROM: its path, or hash if taken from the archive.
+  std::vector<std::string> names{};
+  std::vector<std::span<const uint8_t>> roms{};
+  // Contents of ROM files, ROMs from the archive stay in its mapping.
+  std::vector<std::vector<uint8_t>> files{};
+  std::optional<RomArchive> archive{};
+  std::vector<Movie> movies{};
+};
+
+template <typename Quirks, typename Input>
+Result run_machine(const Batch& batch, const Job& job, Input& input) {
+  const auto& options{batch.options};
+  EmptyGfx gfx;
+  EmptyAudio audio;
+  Chip8<EmptyGfx, Input, EmptyAudio, Quirks, NullProfiler, memory::Frontend> chip8{gfx, input, audio};
+  // Faults end the job with an error in release builds too.
+  chip8.set_trap(memory::throw_fault);
+  chip8.load(batch.roms[job.rom]);
+  chip8.set_engine(options.engine == "block" ? Engine::block : Engine::interpreter);
+  chip8.set_idle_skip(!options.no_idle_skip);
+  if (job.seed) {
+    chip8.seed(*job.seed);
+  }
+
+  Result result;
+  const auto max_cycles{static_cast<uint64_t>(options.cycles)};
+  const auto cycles_per_frame{static_cast<uint64_t>(options.cycles_per_frame)};
+  auto start{Clock::now()};
+  try {
+    while (result.frames < static_cast<uint64_t>(options.frames) && (max_cycles == 0 || chip8.cycles() < max_cycles)) {
+      auto cycles{max_cycles == 0 ? cycles_per_frame : std::min(cycles_per_frame, max_cycles - chip8.cycles())};
+      chip8.step_frame(cycles);
+      ++result.frames;
+    }
+  } catch (const std::exception& e) {
+    result.error = e.what();
+  }
+  result.wall = Clock::now() - start;
+  result.cycles = chip8.cycles();
+  result.skipped = chip8.skipped_cycles();
+
+  const auto& rows{gfx.rows()};
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  result.framebuffer_hash = fnv1a({reinterpret_cast<const uint8_t*>(rows.data()), sizeof(rows)});
+  return result;
+}
+
+template <typename Quirks>
+Result run_job(const Batch& batch, const Job& job) {
+  if (job.movie) {
+    const auto& movie{batch.movies[*job.movie]};
+    try {
+      movie.check(fnv1a(batch.roms[job.rom]), batch.options.quirks,
+                  static_cast<uint64_t>(batch.options.cycles_per_frame));
+    } catch (const std::exception& e) {
+      Result result;
+      result.error = e.what();
+      return result;
+    }
+    ReplayInput input{movie};
+    return run_machine<Quirks>(batch, job, input);
+  }
+  EmptyInput input;
+  return run_machine<Quirks>(batch, job, input);
+}
+
+Result run_job(const Batch& batch, const Job& job) {
+  if (batch.options.quirks == "schip") {
+    return run_job<quirks::SuperChip>(batch, job);
+  }
+  if (batch.options.quirks == "xochip") {
+    return run_job<quirks::XoChip>(batch, job);
+  }
+  return run_job<quirks::CosmacVip>(batch, job);
+}
+
+// Every combination of ROM, seed and movie.
+std::vector<Job> make_jobs(const Batch& batch) {
+  std::vector<Job> jobs;
+  std::vector<std::optional<std::size_t>> movies{std::nullopt};
+  if (!batch.movies.empty()) {
+    movies.clear();
+    for (std::size_t i = 0; i < batch.movies.size(); ++i) {
+      movies.emplace_back(i);
+    }
+  }
+
+  for (std::size_t rom = 0; rom < batch.roms.size(); ++rom) {
+    for (auto movie : movies) {
+      if (batch.options.seeds.empty()) {
+        std::optional<uint64_t> seed{};
+        if (movie) {
+          seed = batch.movies[*movie].seed;
+        }
+        jobs.push_back({rom, seed, movie});
+      }
+      for (auto seed : batch.options.seeds) {
+        jobs.push_back({rom, seed, movie});
+      }
+    }
+  }
+  return jobs;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  CLI::App app{"Chip8 headless batch runner"};
+  Options options;
+  app.add_option("roms", options.roms, "ROM files.");
+  app.add_option("-a,--archive", options.archive, "ROM archive made by chip8-pack, run along with ROM files.");
+  app.add_option("--rom", options.archive_roms,
+                 "Hashes of ROMs in the archive to run, as printed by chip8-pack. All if not given.");
+  app.add_option("-s,--seed", options.seeds, "Seeds to run every ROM with. Movie's or default seed if not given.");
+  app.add_option("-m,--movie", options.movies,
+                 "Movies to take key presses from, every ROM runs with each. Jobs with another ROM, quirks or cycles "
+                 "per frame than recorded fail.");
+  app.add_option("-f,--frames", options.frames, "Frames run per job.")->check(CLI::Range(int64_t{1}, int64_t{1} << 40));
+  app.add_option("-c,--cycles", options.cycles, "Cycles run per job at most, 0 for no limit.")
+      ->check(CLI::Range(int64_t{0}, int64_t{1} << 50));
+  app.add_option("-n,--ipf", options.cycles_per_frame, "CPU cycles per 60 Hz frame.")
+      ->check(CLI::Range(int64_t{1}, int64_t{1'000'000}));
+  app.add_option("-j,--threads", options.threads, "Worker threads, 0 for one per core.")
+      ->check(CLI::Range(int64_t{0}, int64_t{1024}));
+  app.add_option("-e,--engine", options.engine, "Execution engine: interpreter or block.")
+      ->check(CLI::IsMember({"interpreter", "block"}));
+  app.add_option("-q,--quirks", options.quirks, "Quirk profile: vip, schip or xochip.")
+      ->check(CLI::IsMember({"vip", "schip", "xochip"}));
+  app.add_flag("--no-idle-skip", options.no_idle_skip, "Run wait loops cycle by cycle instead of skipping them.");
+  CLI11_PARSE(app, argc, argv);
+
+  Batch batch{options};
+  try {
+    for (const auto& path : options.roms) {
+      batch.names.push_back(path);
+      batch.files.push_back(load_game(path));
+    }
+    for (const auto& file : batch.files) {
+      batch.roms.emplace_back(file);
+    }
+    if (!options.archive.empty()) {
+      auto& archive{batch.archive.emplace(options.archive)};
+      std::vector<uint64_t> hashes;
+      for (const auto& hash : options.archive_roms) {
+        hashes.push_back(parse_rom_hash(hash));
+      }
+      if (options.archive_roms.empty()) {
+        for (std::size_t i = 0; i < archive.size(); ++i) {
+          hashes.push_back(archive.hash(i));
+        }
+      }
+      for (auto hash : hashes) {
+        auto rom{archive.find(hash)};
+        if (!rom) {
+          std::cerr << "ROM " << std::hex << hash << std::dec << " not found in " << options.archive << "\n";
+          return 1;
+        }
+        std::ostringstream name;
+        name << std::hex << std::setw(16) << std::setfill('0') << hash;
+        batch.names.push_back(name.str());
+        batch.roms.push_back(*rom);
+      }
+    }
+    if (batch.roms.empty()) {
+      std::cerr << "No ROMs given.\n";
+      return 1;
+    }
+    for (const auto& path : options.movies) {
+      std::ifstream file{path, std::ios::binary};
+      if (!file) {
+        throw std::runtime_error("Failed to open movie " + path + ".");
+      }
+      batch.movies.push_back(Movie::read(file));
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+  }
+
+  auto jobs{make_jobs(batch)};
+  // One slot per job, so workers share nothing they write.
+  std::vector<Result> results(jobs.size());
+  auto start{Clock::now()};
+  std::size_t threads{0};
+  std::size_t steals{0};
+  {
+    ThreadPool pool{options.threads > 0 ? static_cast<std::size_t>(options.threads)
+                                        : std::thread::hardware_concurrency()};
+    for (std::size_t i = 0; i < jobs.size(); ++i) {
+      pool.submit([&batch, &jobs, &results, i]() { results[i] = run_job(batch, jobs[i]); });
+    }
+    pool.wait();
+    threads = pool.size();
+    steals = pool.steals();
+  }
+  auto wall{std::chrono::duration<double>(Clock::now() - start).count()};
+
+  std::cout << "rom,seed,movie,frames,cycles,framebuffer_hash,wall_ns,error\n";
+  uint64_t total_cycles{0};
+  uint64_t total_skipped{0};
+  for (std::size_t i = 0; i < jobs.size(); ++i) {
+    const auto& job{jobs[i]};
+    const auto& result{results[i]};
+    std::cout << batch.names[job.rom] << "," << (job.seed ? std::to_string(*job.seed) : "") << ","
+              << (job.movie ? options.movies[*job.movie] : "") << "," << result.frames << "," << result.cycles << ","
+              << std::hex << std::setw(16) << std::setfill('0') << result.framebuffer_hash << std::dec << ","
+              << result.wall.count() << "," << result.error << "\n";
+    total_cycles += result.cycles;
+    total_skipped += result.skipped;
+  }
+
+  std::cerr << jobs.size() << " jobs on " << threads << " threads in " << wall << " s, "
+            << static_cast<double>(jobs.size()) / wall << " jobs/s, " << static_cast<double>(total_cycles) / wall / 1e6
+            << " M cycles/s, " << total_skipped << " cycles skipped idle, " << steals << " steals.\n";
+}
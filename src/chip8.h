@@ -1,37 +1,116 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <bitset>
 #include <cstdint>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <span>
+#include <stdexcept>
 #include <thread>
+#include <type_traits>
 #include <vector>
 
 #include "fonts.h"
 #include "game.h"
+#include "instructions.h"
+#include "memory.h"
+#include "profiler.h"
+#include "quirks.h"
 #include "random.h"
 #include "sdl.h"
 
-template <typename Gfx, typename Input, typename Audio>
+// Computed goto is a GCC/Clang extension.
+#if defined(CHIP8_THREADED_DISPATCH) && (defined(__GNUC__) || defined(__clang__))
+#define CHIP8_COMPUTED_GOTO 1
+#else
+#define CHIP8_COMPUTED_GOTO 0
+#endif
+
+// Execution engine used by Chip8::run().
+enum class Engine {
+  // One instruction at a time, through the decoded instruction cache.
+  interpreter,
+  // Straight-line runs of instructions, translated once and cached by start address.
+  block,
+};
+
+// Architectural state of a machine, without the framebuffer. RAM is stored as
+// selected by the memory policy, snapshots always hold it as one array.
+template <typename Rng, typename Ram = memory::FlatRam>
+struct MachineState {
+  Ram ram{};
+  std::array<uint8_t, 16> registers{};
+  uint8_t dt{0};
+  uint8_t st{0};
+  uint16_t ir{0};
+  uint16_t pc{0x200};
+  uint8_t sp{0};
+  std::array<uint16_t, 16> stack{};
+  // Source of RND values, default-seeded until Chip8::seed() is called.
+  Rng rng{};
+  // Instructions executed since power-on.
+  uint64_t cycles{0};
+  // XO-CHIP audio pattern, played one bit per sample at a rate set by pitch.
+  std::array<uint8_t, 16> audio_pattern{default_audio_pattern};
+  uint8_t pitch{default_pitch};
+
+  bool operator==(const MachineState&) const = default;
+
+  // Same state with RAM stored as OtherRam.
+  template <typename OtherRam>
+  explicit operator MachineState<Rng, OtherRam>() const {
+    return {OtherRam(ram), registers, dt, st, ir, pc, sp, stack, rng, cycles, audio_pattern, pitch};
+  }
+};
+
+// Everything needed to resume a machine: its state and the framebuffer.
+// Trivially copyable, so taking or restoring one is a plain copy.
+template <typename Rng>
+struct Snapshot {
+  using State = MachineState<Rng>;
+
+  State machine{};
+  std::array<uint64_t, 32> framebuffer{};
+
+  bool operator==(const Snapshot&) const = default;
+};
+
+template <typename Gfx, typename Input, typename Audio, typename Quirks = quirks::CosmacVip,
+          typename Profiler = NullProfiler, typename Memory = memory::Checked, typename Rng = Pcg32>
 class Chip8 {
  public:
+  using State = MachineState<Rng, typename Memory::Ram>;
+  using Snapshot = ::Snapshot<Rng>;
+  static_assert(std::is_trivially_copyable_v<Snapshot>);
+
+  // Invoked with the fault and the address of the faulting instruction, with
+  // memory::Unchecked only.
+  using Trap = std::function<void(memory::Fault, uint16_t)>;
+
+  // Whether the interpreter dispatches with computed goto.
+  static constexpr bool threaded_dispatch{CHIP8_COMPUTED_GOTO == 1};
+
   Chip8(Gfx& gfx, Input& input, Audio& audio)
       : gfx_{gfx},
         input_{input},
         audio_{audio},
-        ram_{},
-        registers_{},
-        dt_{0},
-        st_{0},
-        ir_{0},
-        pc_{0x200},
-        sp_{0},
-        stack_{}
-
-  {
-    std::copy(fonts.begin(), fonts.end(), ram_.begin());
+        state_{},
+        decoded_{},
+        engine_{Engine::interpreter},
+        block_cache_{},
+        profiler_{},
+        trap_{},
+        idle_skip_{true},
+        skipped_cycles_{0} {
+    memory::write(state_.ram, 0, fonts);
   }
 
-  Chip8(const Chip8& other) : Chip8(other) {}
+  // Copy shares peripherals of the other machine.
+  Chip8(const Chip8& other) : Chip8(other, other.gfx_, other.input_, other.audio_) {}
 
   Chip8& operator=(const Chip8& other) {
     if (this == &other) {
@@ -41,484 +120,801 @@ class Chip8 {
     gfx_ = other.gfx_;
     input_ = other.input_;
     audio_ = other.audio_;
-    ram_ = other.ram_;
-    registers_ = other.registers_;
-    dt_ = other.dt_;
-    st_ = other.st_;
-    ir_ = other.ir_;
-    pc_ = other.pc_;
-    sp_ = other.sp_;
-    stack_ = other.stack_;
+    state_ = other.state_;
+    engine_ = other.engine_;
+    trap_ = other.trap_;
+    idle_skip_ = other.idle_skip_;
+    reset_caches();
     return *this;
   }
 
-  uint8_t ram(uint16_t index) const { return ram_.at(index); }
+  uint8_t ram(uint16_t index) const { return state_.ram.at(index); }
+
+  uint8_t registers(uint8_t index) const { return state_.registers.at(index); }
+
+  uint8_t delay_timer() const { return state_.dt; }
+
+  uint8_t sound_timer() const { return state_.st; }
+
+  uint16_t index_register() const { return state_.ir; }
+
+  uint16_t program_counter() const { return state_.pc; }
+
+  uint8_t stack_pointer() const { return state_.sp; }
+
+  uint16_t stack(uint8_t index) const { return state_.stack.at(index); }
+
+  // Instructions executed since power-on.
+  uint64_t cycles() const { return state_.cycles; }
+
+  uint8_t audio_pattern(uint8_t index) const { return state_.audio_pattern.at(index); }
+
+  uint8_t pitch() const { return state_.pitch; }
+
+  Engine engine() const { return engine_; }
+
+  const Profiler& profiler() const { return profiler_; }
 
-  uint8_t registers(uint8_t index) const { return registers_.at(index); }
+  void set_engine(Engine engine) { engine_ = engine; }
 
-  uint8_t delay_timer() const { return dt_; }
+  // Whether run() skips cycles spent in wait loops, see skip_idle(). On by
+  // default. Never done with a profiler, which counts every instruction.
+  bool idle_skip() const { return idle_skip_; }
 
-  uint8_t sound_timer() const { return st_; }
+  void set_idle_skip(bool enabled) { idle_skip_ = enabled; }
 
-  uint16_t index_register() const { return ir_; }
+  // Cycles counted by cycles() but skipped in wait loops.
+  uint64_t skipped_cycles() const { return skipped_cycles_; }
 
-  uint16_t program_counter() const { return pc_; }
+  // Set callback reporting faults of an unchecked machine. Faults are ignored
+  // if not set.
+  void set_trap(Trap trap) { trap_ = std::move(trap); }
 
-  uint8_t stack_pointer() const { return sp_; }
+  // Restart random number sequence used by RND from given seed. Machines
+  // seeded alike produce identical runs.
+  void seed(uint64_t seed) { state_.rng.seed(seed); }
 
-  uint16_t stack(uint8_t index) const { return stack_.at(index); }
+  void load(const std::vector<uint8_t>& game) { load(std::span<const uint8_t>{game}); }
 
-  void load(const std::vector<uint8_t>& game) {
+  // Copy game to RAM straight from given memory, e.g. a mapped ROM archive.
+  void load(std::span<const uint8_t> game) {
     const auto pc_offset{0x200};
-    std::copy(game.begin(), game.end(), ram_.begin() + pc_offset);
+    if (game.size() > state_.ram.size() - pc_offset) {
+      throw std::length_error("Game too large.");
+    }
+    memory::write(state_.ram, pc_offset, game);
+    reset_caches();
+  }
+
+  // Copy of this machine running on given peripherals, the framebuffer copied
+  // to gfx. With memory::CopyOnWrite both share RAM pages until they write
+  // them, so forking costs about unshared_bytes() of a fresh fork.
+  Chip8 fork(Gfx& gfx, Input& input, Audio& audio) const {
+    gfx.set_rows(gfx_.rows());
+    if constexpr (Quirks::audio_pattern) {
+      audio.set_pattern(state_.audio_pattern);
+      audio.set_pitch(state_.pitch);
+    }
+    return Chip8{*this, gfx, input, audio};
+  }
+
+  // Bytes of memory used by this machine and not shared with forks.
+  std::size_t unshared_bytes() const {
+    auto bytes{sizeof(*this)};
+    if constexpr (Memory::copy_on_write) {
+      bytes += state_.ram.unshared_bytes();
+    }
+    if (block_cache_) {
+      bytes += sizeof(BlockCache) + block_cache_->code.capacity() * sizeof(BlockInstruction);
+    }
+    return bytes;
+  }
+
+  // Copy machine state and framebuffer into snapshot. Does not allocate with
+  // flat RAM.
+  void snapshot(Snapshot& snapshot) const {
+    if constexpr (std::is_same_v<State, typename Snapshot::State>) {
+      snapshot.machine = state_;
+    } else {
+      snapshot.machine = static_cast<typename Snapshot::State>(state_);
+    }
+    snapshot.framebuffer = gfx_.rows();
+  }
+
+  Snapshot snapshot() const {
+    Snapshot result;
+    snapshot(result);
+    return result;
+  }
+
+  // Resume from snapshot. Translated code survives if RAM is unchanged.
+  void restore(const Snapshot& snapshot) {
+    if (snapshot.machine.ram != state_.ram) {
+      reset_caches();
+    }
+    if constexpr (std::is_same_v<State, typename Snapshot::State>) {
+      state_ = snapshot.machine;
+    } else {
+      state_ = static_cast<State>(snapshot.machine);
+    }
+    gfx_.set_rows(snapshot.framebuffer);
+    if constexpr (Quirks::audio_pattern) {
+      audio_.set_pattern(state_.audio_pattern);
+      audio_.set_pitch(state_.pitch);
+    }
+  }
+
+  // Run given number of CPU cycles with the selected engine. Cycles of a
+  // wait loop at the start are skipped if idle skip is on.
+  void run(std::size_t cycles) {
+    if constexpr (!Profiler::enabled) {
+      if (idle_skip_) {
+        cycles -= skip_idle(cycles);
+      }
+    }
+    run_engine(cycles);
+  }
+
+  // Run given number of CPU cycles with the interpreter. Dispatches with
+  // computed goto when built with CHIP8_THREADED_DISPATCH, with the portable
+  // switch in execute_cycle() otherwise.
+  void execute_cycles(std::size_t count) {
+#if CHIP8_COMPUTED_GOTO
+    execute_threaded(count);
+#else
+    for (std::size_t i = 0; i < count; ++i) {
+      execute_cycle();
+    }
+#endif
   }
 
   // Run one CPU cycle.
   void execute_cycle() {
-    auto key_state{input_.key_state()};
-    auto inst_1{ram_.at(pc_)};
-    auto inst_2{ram_.at(pc_ + 1)};
-    auto opcode{static_cast<uint16_t>(inst_1 << 8 | inst_2)};
-
-    switch (opcode & 0xF000) {
-      // CLS and RET
-      case 0x0000: {
-        // CLS
-        if ((opcode & 0x00FF) == 0x00E0) {
-          gfx_.clear_screen();
-          pc_ += 2;
-          break;
-        }
-        // RET
-        else if ((opcode & 0x00FF) == 0x00EE) {
-          --sp_;
-          pc_ = stack_.at(sp_);
-          pc_ += 2;
-          break;
-        } else {
-          throw std::runtime_error("Unknown opcode.");
-        }
-      }
-      // JMP
-      case 0x1000: {
-        auto address{opcode & 0xFFF};
-        pc_ = address;
-        break;
-      }
-      // CALL
-      case 0x2000: {
-        auto address{opcode & 0xFFF};
-        stack_.at(sp_) = pc_;
-        ++sp_;
-        pc_ = address;
-
-        break;
+    ++state_.cycles;
+    check_pc();
+    profile_instruction();
+    if constexpr (Memory::copy_on_write) {
+      auto opcode{fetch(state_.pc)};
+      dispatch(Ops::operands(Ops::opcode_table()[opcode], opcode));
+    } else {
+      auto& cached{Memory::at(decoded_, state_.pc)};
+      if (cached.op == Op::undecoded) {
+        cached = Ops::decode(fetch(state_.pc));
       }
-      // SE VX,NN
-      case 0x3000: {
-        auto reg_x{(opcode & 0x0F00) >> 8};
-        auto value{opcode & 0x00FF};
-
-        if (registers_.at(reg_x) == value) {
-          pc_ += 4;
-        } else {
-          pc_ += 2;
-        }
-        break;
+      // Copied, the instruction may overwrite itself.
+      auto inst{cached};
+      dispatch(inst);
+    }
+  }
+
+  // Run translated blocks, stopping after max_cycles instructions. A block is
+  // cut short when the budget runs out, the rest runs on the next call.
+  void execute_block(std::size_t max_cycles) {
+    if (!block_cache_) {
+      block_cache_ = std::make_unique<BlockCache>();
+    }
+    std::size_t executed{0};
+    while (executed < max_cycles) {
+      check_pc();
+      auto block{Memory::at(block_cache_->blocks, state_.pc)};
+      if (block.length == 0) {
+        block = translate(state_.pc);
       }
-      // SNE VX,NN
-      case 0x4000: {
-        auto reg_x{(opcode & 0x0F00) >> 8};
-        auto value{opcode & 0x00FF};
-
-        if (registers_.at(reg_x) != value) {
-          pc_ += 4;
-        } else {
-          pc_ += 2;
-        }
-        break;
+
+      auto count{std::min<std::size_t>(block.length, max_cycles - executed)};
+      for (std::size_t i = 0; i < count; ++i) {
+        // Copied, the last instruction of a block may invalidate it.
+        auto code{block_cache_->code[block.offset + i]};
+        ++state_.cycles;
+        profile_instruction();
+        code.handler(*this, code.inst);
       }
-      // SE VX,VY
-      case 0x5000: {
-        auto reg_x{(opcode & 0x0F00) >> 8};
-        auto reg_x_value{registers_.at(reg_x)};
-        auto reg_y{(opcode & 0x00F0) >> 4};
-        auto reg_y_value{registers_.at(reg_y)};
-
-        if (reg_x_value == reg_y_value) {
-          pc_ += 4;
-        } else {
-          pc_ += 2;
-        }
-        break;
+      executed += count;
+    }
+  }
+
+  // Run one CPU cycle, decoding the opcode without the decoded instruction
+  // cache. Reference path for tests and benchmarks.
+  void execute_uncached() {
+    ++state_.cycles;
+    check_pc();
+    profile_instruction();
+    dispatch(Ops::decode(fetch(state_.pc)));
+  }
+
+  // Run one 60 Hz frame: given number of CPU cycles, then a timer tick, then
+  // present the frame.
+  void run_frame(std::size_t cycles_per_frame) {
+    step_frame(cycles_per_frame);
+    gfx_.present();
+  }
+
+  // Run one frame without presenting it, for running faster than the display.
+  void step_frame(std::size_t cycles_per_frame) {
+    run(cycles_per_frame);
+    update_timers();
+  }
+
+  // Whether more frames would change nothing but cycles() until a key
+  // changes: timers are stopped and the machine jumps to itself or waits for
+  // a key with none pressed. A host may then sleep instead of running frames.
+  bool waiting_for_input() {
+    if (state_.dt != 0 || state_.st != 0 || state_.pc + 1U >= state_.ram.size()) {
+      return false;
+    }
+    auto opcode{fetch(state_.pc)};
+    const auto forever{std::numeric_limits<std::size_t>::max()};
+    return opcode == (0x1000 | state_.pc) || ((opcode & 0xF0FF) == 0xF00A && key_wait_cycles(forever) == forever);
+  }
+
+  // Decrement delay and sound timers. Invoked once per frame by run_frame().
+  // Never presents, so the frame is only presented by the thread that draws.
+  void update_timers() {
+    if (state_.dt > 0) {
+      --state_.dt;
+    }
+    if (state_.st > 0) {
+      --state_.st;
+    } else {
+      // Stop playing sound.
+      audio_.stop();
+    }
+  }
+
+ private:
+  using Op = isa::Op;
+  using Instruction = isa::Instruction;
+  using Ops = isa::Instructions<Quirks>;
+
+  using Handler = void (*)(Chip8&, const Instruction&);
+
+  // Threaded-code element of a translated block.
+  struct BlockInstruction {
+    Handler handler{};
+    Instruction inst{};
+  };
+
+  // Translated block: BlockCache::code[offset, offset + length) holds the
+  // instructions decoded from RAM [start, end).
+  struct Block {
+    uint32_t offset{};
+    uint16_t length{};
+    uint16_t end{};
+  };
+
+  // Longest block, in instructions.
+  static constexpr std::size_t max_block_length{32};
+  // Translated code is discarded when it grows beyond this many instructions.
+  static constexpr std::size_t max_block_code{0x4000};
+
+  // Tables of the block engine, allocated when it first runs.
+  struct BlockCache {
+    // Translated block per start address. Blocks are dropped when RAM they cover is written.
+    std::array<Block, 0x1000> blocks{};
+    std::vector<BlockInstruction> code{};
+    // Addresses covered by a translated block, possibly stale.
+    std::bitset<0x1000> translated{};
+  };
+
+  // Stands in for the decoded instruction cache of copy-on-write machines.
+  struct NoDecodedCache {};
+
+  Gfx& gfx_;
+  Input& input_;
+  Audio& audio_;
+
+  State state_;
+
+  // Decoded instruction per address. Entries are reset when RAM they cover is written.
+  [[no_unique_address]] std::conditional_t<Memory::copy_on_write, NoDecodedCache, std::array<Instruction, 0x1000>>
+      decoded_;
+
+  Engine engine_;
+  std::unique_ptr<BlockCache> block_cache_;
+
+  [[no_unique_address]] Profiler profiler_;
+
+  Trap trap_;
+
+  bool idle_skip_;
+  uint64_t skipped_cycles_;
+
+  // Copy of other with given peripherals.
+  Chip8(const Chip8& other, Gfx& gfx, Input& input, Audio& audio)
+      : gfx_{gfx},
+        input_{input},
+        audio_{audio},
+        state_{other.state_},
+        decoded_{},
+        engine_{other.engine_},
+        block_cache_{},
+        profiler_{},
+        trap_{other.trap_},
+        idle_skip_{other.idle_skip_},
+        skipped_cycles_{0} {}
+
+  void run_engine(std::size_t cycles) {
+    if (engine_ == Engine::block) {
+      execute_block(cycles);
+      return;
+    }
+    execute_cycles(cycles);
+  }
+
+  // Skip cycles of a wait loop at PC that would leave the machine as it is
+  // until the next timer tick or key change: a jump to itself, LD Vx,K with
+  // no key pressed, or LD Vx,DT, SE or SNE Vx,NN and a jump back that keeps
+  // looping at the current delay timer. Skipped cycles are only counted, the
+  // state is as if they ran. Returns cycles run or skipped, at most
+  // max_cycles.
+  std::size_t skip_idle(std::size_t max_cycles) {
+    if (state_.pc + 1U >= state_.ram.size()) {
+      return 0;
+    }
+    auto opcode{fetch(state_.pc)};
+    if (opcode == (0x1000 | state_.pc)) {
+      return skip(max_cycles);
+    }
+    if ((opcode & 0xF0FF) == 0xF00A) {
+      return skip(key_wait_cycles(max_cycles));
+    }
+    return skip_timer_wait(max_cycles);
+  }
+
+  std::size_t skip(std::size_t cycles) {
+    state_.cycles += cycles;
+    skipped_cycles_ += cycles;
+    return cycles;
+  }
+
+  // Cycles LD Vx,K at PC would wait with no key pressed, at most max_cycles.
+  // Keys of inputs not told the cycle are taken to hold still during run().
+  std::size_t key_wait_cycles(std::size_t max_cycles) {
+    if constexpr (requires { input_.set_cycle(uint64_t{}); } && !requires { input_.next_key_change(); }) {
+      // Keys may change on any cycle.
+      return 0;
+    } else {
+      // Keys as the next cycle sees them.
+      if (key_mask(state_.cycles + 1) != 0) {
+        return 0;
       }
-      // LD Vx,NN
-      case 0x6000: {
-        auto reg_x{(opcode & 0x0F00) >> 8};
-        auto value{opcode & 0x00FF};
-        registers_.at(reg_x) = value;
-        pc_ += 2;
-
-        break;
+      if constexpr (requires { input_.next_key_change(); }) {
+        return static_cast<std::size_t>(
+            std::min<uint64_t>(max_cycles, input_.next_key_change() - state_.cycles - 1));
       }
-      // ADD Vx,NN
-      case 0x7000: {
-        auto reg_x{(opcode & 0x0F00) >> 8};
-        auto value{opcode & 0x00FF};
-        registers_.at(reg_x) += value;
-        pc_ += 2;
-
-        break;
+      return max_cycles;
+    }
+  }
+
+  // Whether head holds LD Vx,DT, SE or SNE Vx,NN and a jump back to head.
+  bool timer_wait_at(uint16_t head) const {
+    if (head + 6U > state_.ram.size()) {
+      return false;
+    }
+    auto load{fetch(head)};
+    auto test{fetch(head + 2)};
+    auto x{load & 0x0F00};
+    return (load & 0xF0FF) == 0xF007 && (test >> 12 == 0x3 || test >> 12 == 0x4) && (test & 0x0F00) == x &&
+           fetch(head + 4) == (0x1000 | head);
+  }
+
+  // Timer wait loop around PC: run to its head, where the test sees the
+  // current delay timer, then skip whole passes if it keeps looping.
+  std::size_t skip_timer_wait(std::size_t max_cycles) {
+    const std::size_t length{3};
+    for (std::size_t phase = 0; phase < length; ++phase) {
+      if (state_.pc < 2 * phase || !timer_wait_at(static_cast<uint16_t>(state_.pc - 2 * phase))) {
+        continue;
       }
-      //
-      case 0x8000: {
-        switch (opcode & 0x000F) {
-          // LD Vx,Vy
-          case 0x0000: {
-            auto reg_x{(opcode & 0x0F00) >> 8};
-            auto reg_y{(opcode & 0x00F0) >> 4};
-            registers_.at(reg_x) = registers_.at(reg_y);
-            pc_ += 2;
-
-            break;
-          }
-          // OR Vx,Vy
-          case 0x0001: {
-            auto reg_x{(opcode & 0x0F00) >> 8};
-            auto reg_y{(opcode & 0x00F0) >> 4};
-            registers_.at(reg_x) |= registers_.at(reg_y);
-            registers_.at(0xF) = 0;
-            pc_ += 2;
-
-            break;
-          }
-          // AND Vx,Vy
-          case 0x0002: {
-            auto reg_x{(opcode & 0x0F00) >> 8};
-            auto reg_y{(opcode & 0x00F0) >> 4};
-            registers_.at(reg_x) &= registers_.at(reg_y);
-            registers_.at(0xF) = 0;
-            pc_ += 2;
-
-            break;
-          }
-          // XOR Vx,Vy
-          case 0x0003: {
-            auto reg_x{(opcode & 0x0F00) >> 8};
-            auto reg_y{(opcode & 0x00F0) >> 4};
-            registers_.at(reg_x) ^= registers_.at(reg_y);
-            registers_.at(0xF) = 0;
-            pc_ += 2;
-
-            break;
-          }
-          // ADD Vx,Vy
-          case 0x0004: {
-            auto reg_x{(opcode & 0x0F00) >> 8};
-            auto reg_y{(opcode & 0x00F0) >> 4};
-            auto res{registers_.at(reg_x) + registers_.at(reg_y)};
-
-            registers_.at(reg_x) = res;
-            registers_.at(0xF) = res > 255 ? 1 : 0;
-
-            pc_ += 2;
-
-            break;
-          }
-          // SUB Vx,Vy
-          case 0x0005: {
-            auto reg_x{(opcode & 0x0F00) >> 8};
-            auto reg_y{(opcode & 0x00F0) >> 4};
-            auto res{registers_.at(reg_x) - registers_.at(reg_y)};
-
-            auto cmp{registers_.at(reg_x) > registers_.at(reg_y)};
-            registers_.at(reg_x) = res;
-            registers_.at(0xF) = cmp ? 1 : 0;
-
-            pc_ += 2;
-
-            break;
-          }
-          // SHR Vx,[Vy]
-          case 0x0006: {
-            auto reg_x{(opcode & 0x0F00) >> 8};
-            auto reg_y{(opcode & 0x00F0) >> 4};
-
-            auto lsb{registers_.at(reg_y) & 0b00000001};
-            registers_.at(reg_x) = registers_.at(reg_y) >> 1;
-            registers_.at(0xF) = lsb;
-
-            pc_ += 2;
-
-            break;
-          }
-          // SUBN Vx,Vy
-          case 0x0007: {
-            auto reg_x{(opcode & 0x0F00) >> 8};
-            auto reg_y{(opcode & 0x00F0) >> 4};
-            auto res{registers_.at(reg_y) - registers_.at(reg_x)};
-
-            auto cmp{registers_.at(reg_y) > registers_.at(reg_x)};
-            registers_.at(reg_x) = res;
-            registers_.at(0xF) = cmp ? 1 : 0;
-
-            pc_ += 2;
-
-            break;
-          }
-          // SHL Vx,[Vy]
-          case 0x000E: {
-            auto reg_x{(opcode & 0x0F00) >> 8};
-            auto reg_y{(opcode & 0x00F0) >> 4};
-
-            auto msb{registers_.at(reg_y) & 0b10000000};
-            registers_.at(reg_x) = registers_.at(reg_y) << 1;
-            registers_.at(0xF) = msb > 0 ? 1 : 0;
-
-            pc_ += 2;
-            break;
-          }
-
-          default: {
-            throw std::runtime_error("Unknown opcode.");
-          }
-        }
-        break;
+      const auto head{static_cast<uint16_t>(state_.pc - 2 * phase)};
+      auto to_head{(length - phase) % length};
+      if (to_head >= max_cycles) {
+        return 0;
       }
-      // SNE Vx,Vy
-      case 0x9000: {
-        auto reg_x{(opcode & 0x0F00) >> 8};
-        auto reg_x_value{registers_.at(reg_x)};
-        auto reg_y{(opcode & 0x00F0) >> 4};
-        auto reg_y_value{registers_.at(reg_y)};
-
-        if (reg_x_value != reg_y_value) {
-          pc_ += 4;
-        } else {
-          pc_ += 2;
-        }
-        break;
+      // The test may see a stale value loaded before the last timer tick.
+      run_engine(to_head);
+      auto test{fetch(head + 2)};
+      auto x{static_cast<uint8_t>(test >> 8 & 0xF)};
+      auto exits{(test >> 12 == 0x3) == (state_.dt == (test & 0xFF))};
+      if (state_.pc != head || exits) {
+        return to_head;
       }
-      // LD I,addr
-      case 0xA000: {
-        auto value{opcode & 0x0FFF};
-        ir_ = value;
-        pc_ += 2;
-        break;
+      auto passes{(max_cycles - to_head) / length};
+      if (passes > 0) {
+        reg(x) = state_.dt;
       }
-      // JP V0,addr
-      case 0xB000: {
-        auto value{opcode & 0x0FFF};
-        pc_ = value + registers_.at(0);
+      return to_head + skip(passes * length);
+    }
+    return 0;
+  }
 
-        break;
-      }
-      // RND Vx,nn
-      case 0xC000: {
-        auto reg_x{(opcode & 0x0F00) >> 8};
-        auto value{opcode & 0x00FF};
-        registers_.at(reg_x) = random(0, 0xFF) & value;
-        pc_ += 2;
-        break;
+  uint8_t& reg(std::size_t index) { return Memory::at(state_.registers, index); }
+
+  uint8_t mem(std::size_t address) const { return Memory::at(state_.ram, address); }
+
+  // Report fault of the instruction at PC: throw with checked memory, invoke
+  // trap with unchecked.
+  [[gnu::noinline, gnu::cold]] void fault(memory::Fault kind) {
+    if constexpr (Memory::checked) {
+      memory::throw_fault(kind, state_.pc);
+    } else if (trap_) {
+      trap_(kind, state_.pc);
+    }
+  }
+
+  // Fault if the instruction at PC runs past the end of RAM, then wrap PC.
+  // Checked machines fault on the fetch instead.
+  void check_pc() {
+    if constexpr (!Memory::checked) {
+      if (state_.pc + 1U >= state_.ram.size()) [[unlikely]] {
+        fault(memory::Fault::address_out_of_range);
+        state_.pc &= 0xFFF;
       }
-      // DRW Vx,Vy,n
-      case 0xD000: {
-        auto reg_x{(opcode & 0x0F00) >> 8};
-        auto reg_y{(opcode & 0x00F0) >> 4};
-
-        auto n{opcode & 0x000F};
-
-        registers_.at(0xF) = 0;
-        for (int y = 0; y < n; ++y) {
-          auto line{ram_.at(ir_ + y)};
-          for (int x = 0; x < 8; ++x) {
-            auto pos_x{registers_.at(reg_x)};
-            auto pos_y{registers_.at(reg_y)};
-            if ((line & (0x80 >> x)) != 0) {
-              bool current_state{gfx_.pixel(pos_x + x, pos_y + y)};
-              if (current_state) {
-                registers_.at(0xF) = 1;
-              }
-
-              gfx_.set_pixel(pos_x + x, pos_y + y, !current_state != false);
-            }
-          }
-        }
-
-        pc_ += 2;
-        break;
+    }
+  }
+
+  // Pressed keys, telling input the current cycle if it wants to know.
+  uint16_t key_mask() { return key_mask(state_.cycles); }
+
+  uint16_t key_mask(uint64_t cycle) {
+    if constexpr (requires { input_.set_cycle(uint64_t{}); }) {
+      input_.set_cycle(cycle);
+    }
+    return input_.key_mask();
+  }
+
+  void profile_instruction() {
+    if constexpr (Profiler::enabled) {
+      profiler_.on_instruction(state_.pc, fetch(state_.pc));
+    }
+  }
+
+  uint16_t fetch(uint16_t address) const {
+    auto inst_1{Memory::at(state_.ram, address)};
+    auto inst_2{Memory::at(state_.ram, address + 1)};
+    return static_cast<uint16_t>(inst_1 << 8 | inst_2);
+  }
+
+  // Write RAM, invalidating decoded instructions and blocks overlapping the address.
+  void write_ram(uint16_t address, uint8_t value) {
+    Memory::at(state_.ram, address) = value;
+    if constexpr (!Memory::checked) {
+      address &= 0xFFF;
+    }
+    if constexpr (!Memory::copy_on_write) {
+      decoded_[address] = {};
+      // Wrapped around for unchecked machines.
+      if (address > 0 || !Memory::checked) {
+        Memory::at(decoded_, address - 1) = {};
       }
-      // SKP and SKNP
-      case 0xE000: {
-        auto reg_x{(opcode & 0x0F00) >> 8};
-        switch (opcode & 0x00FF) {
-          case 0x009E: {
-            if (key_state.at(registers_.at(reg_x))) {
-              pc_ += 2;
-            }
-            break;
-          }
-          case 0x00A1: {
-            if (!key_state.at(registers_.at(reg_x))) {
-              pc_ += 2;
-            }
-            break;
-          }
-          default: {
-            throw std::runtime_error("Unknown opcode.");
-          }
-        }
-
-        pc_ += 2;
-        break;
+    }
+    if (block_cache_ && block_cache_->translated[address]) {
+      invalidate_blocks(address);
+    }
+  }
+
+  // Write values to RAM [address, address + values.size()), which must be within RAM.
+  void write_ram(uint16_t address, std::span<const uint8_t> values) {
+    memory::write(state_.ram, address, values);
+    if constexpr (!Memory::copy_on_write) {
+      std::fill_n(decoded_.begin() + address, values.size(), Instruction{});
+      if (address > 0 || !Memory::checked) {
+        Memory::at(decoded_, address - 1) = {};
       }
-      case 0xF000: {
-        switch (opcode & 0x00FF) {
-          // LD Vx,DT
-          case 0x0007: {
-            auto reg_x{(opcode & 0x0F00) >> 8};
-            registers_.at(reg_x) = dt_;
-            pc_ += 2;
-            break;
-          }
-          // LD Vx,K
-          case 0x000A: {
-            auto key_pressed{std::any_of(key_state.begin(), key_state.end(), [](bool value) { return value; })};
-            if (!key_pressed) {
-              break;
-            }
-
-            auto reg_x{(opcode & 0x0F00) >> 8};
-            auto key_index{std::find(key_state.begin(), key_state.end(), true) - key_state.begin()};
-            registers_.at(reg_x) = key_index;
-
-            pc_ += 2;
-            break;
-          }
-          // LD DT,Vx
-          case 0x0015: {
-            auto reg_x{(opcode & 0x0F00) >> 8};
-            dt_ = registers_.at(reg_x);
-            pc_ += 2;
-            break;
-          }
-          // LD ST,Vx
-          case 0x0018: {
-            auto reg_x{(opcode & 0x0F00) >> 8};
-            st_ = registers_.at(reg_x);
-            pc_ += 2;
-            // Start playing sound.
-            if (st_ > 0) {
-              audio_.play();
-            }
-
-            break;
-          }
-          // ADD I,Vx
-          case 0x001E: {
-            auto reg_x{(opcode & 0x0F00) >> 8};
-            ir_ += registers_.at(reg_x);
-            pc_ += 2;
-            break;
-          }
-          // LD F, Vx
-          case 0x0029: {
-            auto reg_x{(opcode & 0x0F00) >> 8};
-            ir_ = registers_.at(reg_x) * 0x5;
-            pc_ += 2;
-            break;
-          }
-          // LD B, Vx
-          case 0x0033: {
-            auto reg_x{(opcode & 0x0F00) >> 8};
-
-            ram_.at(ir_) = registers_.at(reg_x) / 100;
-            ram_.at(ir_ + 1) = (registers_.at(reg_x) / 10) % 10;
-            ram_.at(ir_ + 2) = (registers_.at(reg_x) % 100) % 10;
-
-            pc_ += 2;
-            break;
-          }
-          // LD [I],Vx
-          case 0x0055: {
-            auto reg_x{(opcode & 0x0F00) >> 8};
-            for (int i = 0; i <= reg_x; ++i) {
-              ram_.at(ir_) = registers_.at(i);
-              ir_ += 1;
-            }
-
-            pc_ += 2;
-            break;
-          }
-          // LD Vx,[I]
-          case 0x0065: {
-            auto reg_x{(opcode & 0x0F00) >> 8};
-            for (int i = 0; i <= reg_x; ++i) {
-              registers_.at(i) = ram_.at(ir_);
-              ir_ += 1;
-            }
-
-            pc_ += 2;
-            break;
-          }
-
-          default: {
-            throw std::runtime_error("Unknown opcode.");
-          }
-        }
-        break;
+    }
+    if (!block_cache_) {
+      return;
+    }
+    for (std::size_t i = 0; i < values.size(); ++i) {
+      if (block_cache_->translated[address + i]) {
+        invalidate_blocks(address + i);
       }
+    }
+  }
 
-      default: {
-        throw std::runtime_error("Unknown opcode.");
-      }
+  void reset_caches() {
+    if constexpr (!Memory::copy_on_write) {
+      decoded_ = {};
+    }
+    if (block_cache_) {
+      block_cache_->blocks = {};
+      block_cache_->code.clear();
+      block_cache_->translated.reset();
+    }
+  }
+
+  // Translate straight-line code starting at given address.
+  Block translate(uint16_t start) {
+    auto& cache{*block_cache_};
+    if (cache.code.size() + max_block_length > max_block_code) {
+      reset_caches();
     }
 
-    gfx_.render();
+    Block block{static_cast<uint32_t>(cache.code.size()), 0, start};
+    Instruction inst{};
+    do {
+      inst = Ops::decode(fetch(block.end));
+      cache.code.push_back({handler(inst.op), inst});
+      ++block.length;
+      block.end += 2;
+    } while (!Ops::ends_block(inst.op) && block.length < max_block_length && block.end + 1U < state_.ram.size());
+
+    for (auto address = start; address < block.end && address < state_.ram.size(); ++address) {
+      cache.translated.set(address);
+    }
+    cache.blocks.at(start) = block;
+    return block;
   }
 
-  // Update timers. Should be invoked by independent clock.
-  void update_timers() {
-    if (dt_ > 0) {
-      --dt_;
+  // Drop blocks covering given address.
+  void invalidate_blocks(uint16_t address) {
+    const auto max_block_bytes{static_cast<int>(max_block_length * 2)};
+    for (int start = std::max(0, address - max_block_bytes + 1); start <= address; ++start) {
+      auto& block{block_cache_->blocks.at(start)};
+      if (block.length > 0 && block.end > address) {
+        block = {};
+      }
     }
-    if (st_ > 0) {
-      --st_;
-    } else {
-      // Stop playing sound.
-      audio_.stop();
+  }
+
+#if CHIP8_COMPUTED_GOTO
+
+  // Interpreter loop dispatching with computed goto, one indirect jump per handler.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+  void execute_threaded(std::size_t count) {
+    // Indexed by Op.
+    static const void* const labels[]{
+        &&undecoded,
+        &&unknown,
+        &&cls,
+        &&ret,
+        &&jp,
+        &&call,
+        &&se_vx_nn,
+        &&sne_vx_nn,
+        &&se_vx_vy,
+        &&ld_vx_nn,
+        &&add_vx_nn,
+        &&ld_vx_vy,
+        &&or_vx_vy,
+        &&and_vx_vy,
+        &&xor_vx_vy,
+        &&add_vx_vy,
+        &&sub_vx_vy,
+        &&shr_vx_vy,
+        &&subn_vx_vy,
+        &&shl_vx_vy,
+        &&sne_vx_vy,
+        &&ld_i_addr,
+        &&jp_v0_addr,
+        &&rnd_vx_nn,
+        &&drw_vx_vy_n,
+        &&skp_vx,
+        &&sknp_vx,
+        &&ld_vx_dt,
+        &&ld_vx_k,
+        &&ld_dt_vx,
+        &&ld_st_vx,
+        &&add_i_vx,
+        &&ld_f_vx,
+        &&ld_b_vx,
+        &&ld_mem_vx,
+        &&ld_vx_mem,
+        &&ld_audio_i,
+        &&ld_pitch_vx,
+    };
+    const auto& table{Ops::opcode_table()};
+    Core core{*this};
+    Instruction inst{};
+
+#define CHIP8_NEXT()                                 \
+  do {                                               \
+    if (count == 0) {                                \
+      return;                                        \
+    }                                                \
+    --count;                                         \
+    ++state_.cycles;                                 \
+    check_pc();                                      \
+    profile_instruction();                           \
+    auto opcode{fetch(state_.pc)};                   \
+    inst = Ops::operands(table[opcode], opcode);     \
+    goto* labels[static_cast<std::size_t>(inst.op)]; \
+  } while (false)
+
+    CHIP8_NEXT();
+  undecoded:
+    Ops::op_unknown(core, inst);
+    CHIP8_NEXT();
+  unknown:
+    Ops::op_unknown(core, inst);
+    CHIP8_NEXT();
+  cls:
+    Ops::op_cls(core, inst);
+    CHIP8_NEXT();
+  ret:
+    Ops::op_ret(core, inst);
+    CHIP8_NEXT();
+  jp:
+    Ops::op_jp(core, inst);
+    CHIP8_NEXT();
+  call:
+    Ops::op_call(core, inst);
+    CHIP8_NEXT();
+  se_vx_nn:
+    Ops::op_se_vx_nn(core, inst);
+    CHIP8_NEXT();
+  sne_vx_nn:
+    Ops::op_sne_vx_nn(core, inst);
+    CHIP8_NEXT();
+  se_vx_vy:
+    Ops::op_se_vx_vy(core, inst);
+    CHIP8_NEXT();
+  ld_vx_nn:
+    Ops::op_ld_vx_nn(core, inst);
+    CHIP8_NEXT();
+  add_vx_nn:
+    Ops::op_add_vx_nn(core, inst);
+    CHIP8_NEXT();
+  ld_vx_vy:
+    Ops::op_ld_vx_vy(core, inst);
+    CHIP8_NEXT();
+  or_vx_vy:
+    Ops::op_or_vx_vy(core, inst);
+    CHIP8_NEXT();
+  and_vx_vy:
+    Ops::op_and_vx_vy(core, inst);
+    CHIP8_NEXT();
+  xor_vx_vy:
+    Ops::op_xor_vx_vy(core, inst);
+    CHIP8_NEXT();
+  add_vx_vy:
+    Ops::op_add_vx_vy(core, inst);
+    CHIP8_NEXT();
+  sub_vx_vy:
+    Ops::op_sub_vx_vy(core, inst);
+    CHIP8_NEXT();
+  shr_vx_vy:
+    Ops::op_shr_vx_vy(core, inst);
+    CHIP8_NEXT();
+  subn_vx_vy:
+    Ops::op_subn_vx_vy(core, inst);
+    CHIP8_NEXT();
+  shl_vx_vy:
+    Ops::op_shl_vx_vy(core, inst);
+    CHIP8_NEXT();
+  sne_vx_vy:
+    Ops::op_sne_vx_vy(core, inst);
+    CHIP8_NEXT();
+  ld_i_addr:
+    Ops::op_ld_i_addr(core, inst);
+    CHIP8_NEXT();
+  jp_v0_addr:
+    Ops::op_jp_v0_addr(core, inst);
+    CHIP8_NEXT();
+  rnd_vx_nn:
+    Ops::op_rnd_vx_nn(core, inst);
+    CHIP8_NEXT();
+  drw_vx_vy_n:
+    Ops::op_drw_vx_vy_n(core, inst);
+    CHIP8_NEXT();
+  skp_vx:
+    Ops::op_skp_vx(core, inst);
+    CHIP8_NEXT();
+  sknp_vx:
+    Ops::op_sknp_vx(core, inst);
+    CHIP8_NEXT();
+  ld_vx_dt:
+    Ops::op_ld_vx_dt(core, inst);
+    CHIP8_NEXT();
+  ld_vx_k:
+    Ops::op_ld_vx_k(core, inst);
+    CHIP8_NEXT();
+  ld_dt_vx:
+    Ops::op_ld_dt_vx(core, inst);
+    CHIP8_NEXT();
+  ld_st_vx:
+    Ops::op_ld_st_vx(core, inst);
+    CHIP8_NEXT();
+  add_i_vx:
+    Ops::op_add_i_vx(core, inst);
+    CHIP8_NEXT();
+  ld_f_vx:
+    Ops::op_ld_f_vx(core, inst);
+    CHIP8_NEXT();
+  ld_b_vx:
+    Ops::op_ld_b_vx(core, inst);
+    CHIP8_NEXT();
+  ld_mem_vx:
+    Ops::op_ld_mem_vx(core, inst);
+    CHIP8_NEXT();
+  ld_vx_mem:
+    Ops::op_ld_vx_mem(core, inst);
+    CHIP8_NEXT();
+  ld_audio_i:
+    Ops::op_ld_audio_i(core, inst);
+    CHIP8_NEXT();
+  ld_pitch_vx:
+    Ops::op_ld_pitch_vx(core, inst);
+    CHIP8_NEXT();
+
+#undef CHIP8_NEXT
+  }
+#pragma GCC diagnostic pop
+#endif
+
+  // Machine as seen by the instruction handlers.
+  struct Core {
+    Chip8& chip8;
+
+    uint8_t& reg(std::size_t index) { return chip8.reg(index); }
+    std::array<uint8_t, 16>& registers() { return chip8.state_.registers; }
+    uint16_t& pc() { return chip8.state_.pc; }
+    uint16_t& ir() { return chip8.state_.ir; }
+    uint8_t& sp() { return chip8.state_.sp; }
+    uint16_t& stack(std::size_t index) { return Memory::at(chip8.state_.stack, index); }
+    uint8_t& dt() { return chip8.state_.dt; }
+    uint8_t& st() { return chip8.state_.st; }
+    std::array<uint8_t, 16>& audio_pattern() { return chip8.state_.audio_pattern; }
+    uint8_t& pitch() { return chip8.state_.pitch; }
+
+    const typename Memory::Ram& ram() const { return chip8.state_.ram; }
+    uint8_t mem(std::size_t address) const { return chip8.mem(address); }
+    void write_ram(uint16_t address, uint8_t value) { chip8.write_ram(address, value); }
+    void write_ram(uint16_t address, std::span<const uint8_t> values) { chip8.write_ram(address, values); }
+
+    Rng& rng() { return chip8.state_.rng; }
+    Gfx& gfx() { return chip8.gfx_; }
+    Audio& audio() { return chip8.audio_; }
+    uint16_t key_mask() { return chip8.key_mask(); }
+
+    void fault(memory::Fault kind) { chip8.fault(kind); }
+
+    void on_call(uint16_t address) {
+      if constexpr (Profiler::enabled) {
+        chip8.profiler_.on_call(address);
+      }
     }
+
+    void on_return() {
+      if constexpr (Profiler::enabled) {
+        chip8.profiler_.on_return();
+      }
+    }
+  };
+
+  // Threaded-code handler of an instruction kind.
+  static Handler handler(Op op) {
+    return isa::visit(op, []<Op O>() -> Handler { return &Chip8::invoke<O>; });
   }
 
- private:
-  Gfx& gfx_;
-  Input& input_;
-  Audio& audio_;
+  template <Op O>
+  static void invoke(Chip8& chip8, const Instruction& inst) {
+    Core core{chip8};
+    Ops::template execute<O>(core, inst);
+  }
 
-  std::array<uint8_t, 0x1000> ram_;
-  std::array<uint8_t, 16> registers_;
-  uint8_t dt_;
-  uint8_t st_;
-  uint16_t ir_;
-  uint16_t pc_;
-  uint8_t sp_;
-  std::array<uint16_t, 16> stack_;
+  // Jump to the handler of a decoded instruction.
+  void dispatch(const Instruction& inst) {
+    Core core{*this};
+    Ops::execute(core, inst);
+  }
 
   void print_status(uint16_t current_opcode) const {
     std::cout << "CURRENT OPCODE: " << std::hex << current_opcode << std::endl;
     std::cout << "registers_" << std::endl;
     for (int i = 0; i < 16; ++i) {
-      std::cout << i << ": " << (int)registers_.at(i) << std::endl;
+      std::cout << i << ": " << (int)state_.registers.at(i) << std::endl;
     }
-    std::cout << "DT: " << (int)dt_ << std::endl;
-    std::cout << "ST: " << (int)st_ << std::endl;
-    std::cout << "I: " << (int)ir_ << std::endl;
-    std::cout << "PC: " << (int)pc_ << std::endl;
-    std::cout << "SP: " << (int)sp_ << std::endl;
+    std::cout << "DT: " << (int)state_.dt << std::endl;
+    std::cout << "ST: " << (int)state_.st << std::endl;
+    std::cout << "I: " << (int)state_.ir << std::endl;
+    std::cout << "PC: " << (int)state_.pc << std::endl;
+    std::cout << "SP: " << (int)state_.sp << std::endl;
     std::cout << "stack_" << std::endl;
     for (int i = 0; i < 16; ++i) {
-      std::cout << i << ": " << (int)stack_.at(i) << std::endl;
+      std::cout << i << ": " << (int)state_.stack.at(i) << std::endl;
     }
     std::cout << std::endl;
   }
-};
\ No newline at end of file
+};
@@ -2,12 +2,12 @@
 
 #include <filesystem>
 #include <fstream>
+#include <stdexcept>
 
 std::vector<uint8_t> load_game(const std::string& file_path) {
   using namespace std::filesystem;
 
   path path{file_path};
-  exists(path);
 
   std::error_code ec;
   if (!exists(path, ec)) {
@@ -19,7 +19,10 @@ std::vector<uint8_t> load_game(const std::string& file_path) {
   std::ifstream rom_input(path.c_str(), std::ios::in | std::ios::binary);
   // Ignoring due to no other way of doing it.
   // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-  rom_input.readsome(reinterpret_cast<char*>(&data[0]), static_cast<std::streamsize>(size));
+  rom_input.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(size));
+  if (!rom_input) {
+    throw std::runtime_error("Failed to read ROM.");
+  }
 
   return data;
 }
\ No newline at end of file
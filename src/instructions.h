@@ -0,0 +1,932 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "memory.h"
+
+// Decoding and semantics of CHIP-8 instructions, shared by Chip8 and Lockstep.
+// Handlers act on a machine through an accessor M, a handle passed by value,
+// so each machine keeps its own storage. M provides:
+// - reg(i), pc(), ir(), sp(), stack(i), dt(), st(), audio_pattern() and
+//   pitch(): references to the machine state, indices checked or wrapped as
+//   its memory policy does,
+// - registers(), optional: all 16 registers, if they are contiguous,
+// - ram(), mem(address) and write_ram(address, value or values): RAM,
+// - rng(), gfx(), audio() and key_mask(): peripherals,
+// - fault(kind): report a fault, returning only if execution goes on,
+// - on_call(address) and on_return(): profiler hooks.
+namespace isa {
+
+// Instruction kinds, each handled by the matching Instructions::op_*().
+enum class Op : uint8_t {
+  undecoded,
+  unknown,
+  cls,
+  ret,
+  jp,
+  call,
+  se_vx_nn,
+  sne_vx_nn,
+  se_vx_vy,
+  ld_vx_nn,
+  add_vx_nn,
+  ld_vx_vy,
+  or_vx_vy,
+  and_vx_vy,
+  xor_vx_vy,
+  add_vx_vy,
+  sub_vx_vy,
+  shr_vx_vy,
+  subn_vx_vy,
+  shl_vx_vy,
+  sne_vx_vy,
+  ld_i_addr,
+  jp_v0_addr,
+  rnd_vx_nn,
+  drw_vx_vy_n,
+  skp_vx,
+  sknp_vx,
+  ld_vx_dt,
+  ld_vx_k,
+  ld_dt_vx,
+  ld_st_vx,
+  add_i_vx,
+  ld_f_vx,
+  ld_b_vx,
+  ld_mem_vx,
+  ld_vx_mem,
+  ld_audio_i,
+  ld_pitch_vx,
+};
+
+// Opcode with its operand fields already extracted.
+struct Instruction {
+  Op op{Op::undecoded};
+  uint8_t x{};
+  uint8_t y{};
+  uint8_t n{};
+  uint8_t nn{};
+  uint16_t nnn{};
+};
+
+// Invoke f.template operator()<op>() with given op as a constant, so a
+// handler is chosen once and inlined. Undecoded and unknown instructions map
+// to Op::unknown. Always inlined, so the switch lands in the caller and the
+// machine accessor stays in registers.
+template <typename F>
+[[gnu::always_inline]] inline decltype(auto) visit(Op op, F&& f) {
+  switch (op) {
+    case Op::cls: {
+      return f.template operator()<Op::cls>();
+    }
+    case Op::ret: {
+      return f.template operator()<Op::ret>();
+    }
+    case Op::jp: {
+      return f.template operator()<Op::jp>();
+    }
+    case Op::call: {
+      return f.template operator()<Op::call>();
+    }
+    case Op::se_vx_nn: {
+      return f.template operator()<Op::se_vx_nn>();
+    }
+    case Op::sne_vx_nn: {
+      return f.template operator()<Op::sne_vx_nn>();
+    }
+    case Op::se_vx_vy: {
+      return f.template operator()<Op::se_vx_vy>();
+    }
+    case Op::ld_vx_nn: {
+      return f.template operator()<Op::ld_vx_nn>();
+    }
+    case Op::add_vx_nn: {
+      return f.template operator()<Op::add_vx_nn>();
+    }
+    case Op::ld_vx_vy: {
+      return f.template operator()<Op::ld_vx_vy>();
+    }
+    case Op::or_vx_vy: {
+      return f.template operator()<Op::or_vx_vy>();
+    }
+    case Op::and_vx_vy: {
+      return f.template operator()<Op::and_vx_vy>();
+    }
+    case Op::xor_vx_vy: {
+      return f.template operator()<Op::xor_vx_vy>();
+    }
+    case Op::add_vx_vy: {
+      return f.template operator()<Op::add_vx_vy>();
+    }
+    case Op::sub_vx_vy: {
+      return f.template operator()<Op::sub_vx_vy>();
+    }
+    case Op::shr_vx_vy: {
+      return f.template operator()<Op::shr_vx_vy>();
+    }
+    case Op::subn_vx_vy: {
+      return f.template operator()<Op::subn_vx_vy>();
+    }
+    case Op::shl_vx_vy: {
+      return f.template operator()<Op::shl_vx_vy>();
+    }
+    case Op::sne_vx_vy: {
+      return f.template operator()<Op::sne_vx_vy>();
+    }
+    case Op::ld_i_addr: {
+      return f.template operator()<Op::ld_i_addr>();
+    }
+    case Op::jp_v0_addr: {
+      return f.template operator()<Op::jp_v0_addr>();
+    }
+    case Op::rnd_vx_nn: {
+      return f.template operator()<Op::rnd_vx_nn>();
+    }
+    case Op::drw_vx_vy_n: {
+      return f.template operator()<Op::drw_vx_vy_n>();
+    }
+    case Op::skp_vx: {
+      return f.template operator()<Op::skp_vx>();
+    }
+    case Op::sknp_vx: {
+      return f.template operator()<Op::sknp_vx>();
+    }
+    case Op::ld_vx_dt: {
+      return f.template operator()<Op::ld_vx_dt>();
+    }
+    case Op::ld_vx_k: {
+      return f.template operator()<Op::ld_vx_k>();
+    }
+    case Op::ld_dt_vx: {
+      return f.template operator()<Op::ld_dt_vx>();
+    }
+    case Op::ld_st_vx: {
+      return f.template operator()<Op::ld_st_vx>();
+    }
+    case Op::add_i_vx: {
+      return f.template operator()<Op::add_i_vx>();
+    }
+    case Op::ld_f_vx: {
+      return f.template operator()<Op::ld_f_vx>();
+    }
+    case Op::ld_b_vx: {
+      return f.template operator()<Op::ld_b_vx>();
+    }
+    case Op::ld_mem_vx: {
+      return f.template operator()<Op::ld_mem_vx>();
+    }
+    case Op::ld_vx_mem: {
+      return f.template operator()<Op::ld_vx_mem>();
+    }
+    case Op::ld_audio_i: {
+      return f.template operator()<Op::ld_audio_i>();
+    }
+    case Op::ld_pitch_vx: {
+      return f.template operator()<Op::ld_pitch_vx>();
+    }
+    default: {
+      return f.template operator()<Op::unknown>();
+    }
+  }
+}
+
+template <typename Quirks>
+class Instructions {
+ public:
+  // Instruction of given kind with operand fields extracted from opcode.
+  static Instruction operands(Op op, uint16_t opcode) {
+    return {op,
+            static_cast<uint8_t>((opcode & 0x0F00) >> 8),
+            static_cast<uint8_t>((opcode & 0x00F0) >> 4),
+            static_cast<uint8_t>(opcode & 0x000F),
+            static_cast<uint8_t>(opcode & 0x00FF),
+            static_cast<uint16_t>(opcode & 0x0FFF)};
+  }
+
+  static Instruction decode(uint16_t opcode) {
+    auto inst{operands(Op::unknown, opcode)};
+
+    switch (opcode & 0xF000) {
+      case 0x0000: {
+        if ((opcode & 0x00FF) == 0x00E0) {
+          inst.op = Op::cls;
+        } else if ((opcode & 0x00FF) == 0x00EE) {
+          inst.op = Op::ret;
+        }
+        break;
+      }
+      case 0x1000: {
+        inst.op = Op::jp;
+        break;
+      }
+      case 0x2000: {
+        inst.op = Op::call;
+        break;
+      }
+      case 0x3000: {
+        inst.op = Op::se_vx_nn;
+        break;
+      }
+      case 0x4000: {
+        inst.op = Op::sne_vx_nn;
+        break;
+      }
+      case 0x5000: {
+        inst.op = Op::se_vx_vy;
+        break;
+      }
+      case 0x6000: {
+        inst.op = Op::ld_vx_nn;
+        break;
+      }
+      case 0x7000: {
+        inst.op = Op::add_vx_nn;
+        break;
+      }
+      case 0x8000: {
+        switch (opcode & 0x000F) {
+          case 0x0000: {
+            inst.op = Op::ld_vx_vy;
+            break;
+          }
+          case 0x0001: {
+            inst.op = Op::or_vx_vy;
+            break;
+          }
+          case 0x0002: {
+            inst.op = Op::and_vx_vy;
+            break;
+          }
+          case 0x0003: {
+            inst.op = Op::xor_vx_vy;
+            break;
+          }
+          case 0x0004: {
+            inst.op = Op::add_vx_vy;
+            break;
+          }
+          case 0x0005: {
+            inst.op = Op::sub_vx_vy;
+            break;
+          }
+          case 0x0006: {
+            inst.op = Op::shr_vx_vy;
+            break;
+          }
+          case 0x0007: {
+            inst.op = Op::subn_vx_vy;
+            break;
+          }
+          case 0x000E: {
+            inst.op = Op::shl_vx_vy;
+            break;
+          }
+          default: {
+            break;
+          }
+        }
+        break;
+      }
+      case 0x9000: {
+        inst.op = Op::sne_vx_vy;
+        break;
+      }
+      case 0xA000: {
+        inst.op = Op::ld_i_addr;
+        break;
+      }
+      case 0xB000: {
+        inst.op = Op::jp_v0_addr;
+        break;
+      }
+      case 0xC000: {
+        inst.op = Op::rnd_vx_nn;
+        break;
+      }
+      case 0xD000: {
+        inst.op = Op::drw_vx_vy_n;
+        break;
+      }
+      case 0xE000: {
+        switch (opcode & 0x00FF) {
+          case 0x009E: {
+            inst.op = Op::skp_vx;
+            break;
+          }
+          case 0x00A1: {
+            inst.op = Op::sknp_vx;
+            break;
+          }
+          default: {
+            break;
+          }
+        }
+        break;
+      }
+      case 0xF000: {
+        switch (opcode & 0x00FF) {
+          case 0x0007: {
+            inst.op = Op::ld_vx_dt;
+            break;
+          }
+          case 0x000A: {
+            inst.op = Op::ld_vx_k;
+            break;
+          }
+          case 0x0015: {
+            inst.op = Op::ld_dt_vx;
+            break;
+          }
+          case 0x0018: {
+            inst.op = Op::ld_st_vx;
+            break;
+          }
+          case 0x001E: {
+            inst.op = Op::add_i_vx;
+            break;
+          }
+          case 0x0029: {
+            inst.op = Op::ld_f_vx;
+            break;
+          }
+          case 0x0033: {
+            inst.op = Op::ld_b_vx;
+            break;
+          }
+          case 0x0055: {
+            inst.op = Op::ld_mem_vx;
+            break;
+          }
+          case 0x0065: {
+            inst.op = Op::ld_vx_mem;
+            break;
+          }
+          case 0x0002: {
+            if constexpr (Quirks::audio_pattern) {
+              if (opcode == 0xF002) {
+                inst.op = Op::ld_audio_i;
+              }
+            }
+            break;
+          }
+          case 0x003A: {
+            if constexpr (Quirks::audio_pattern) {
+              inst.op = Op::ld_pitch_vx;
+            }
+            break;
+          }
+          default: {
+            break;
+          }
+        }
+        break;
+      }
+      default: {
+        break;
+      }
+    }
+
+    return inst;
+  }
+
+  // Kind of every 16-bit opcode, shared by all machines.
+  static const std::array<Op, 0x10000>& opcode_table() {
+    static const auto table{[] {
+      std::array<Op, 0x10000> ops{};
+      for (std::size_t opcode = 0; opcode < ops.size(); ++opcode) {
+        ops[opcode] = decode(static_cast<uint16_t>(opcode)).op;
+      }
+      return ops;
+    }()};
+    return table;
+  }
+
+  // Whether instruction may transfer control or modify code, so it has to be last in a block.
+  static bool ends_block(Op op) {
+    switch (op) {
+      case Op::unknown:
+      case Op::ret:
+      case Op::jp:
+      case Op::call:
+      case Op::se_vx_nn:
+      case Op::sne_vx_nn:
+      case Op::se_vx_vy:
+      case Op::sne_vx_vy:
+      case Op::jp_v0_addr:
+      case Op::skp_vx:
+      case Op::sknp_vx:
+      case Op::ld_vx_k:
+      case Op::ld_b_vx:
+      case Op::ld_mem_vx: {
+        return true;
+      }
+      default: {
+        return false;
+      }
+    }
+  }
+
+  // Run instruction of kind O on machine m.
+  template <Op O, typename M>
+  [[gnu::always_inline]] static void execute(M m, const Instruction& inst) {
+    if constexpr (O == Op::unknown) {
+      op_unknown(m, inst);
+    } else if constexpr (O == Op::cls) {
+      op_cls(m, inst);
+    } else if constexpr (O == Op::ret) {
+      op_ret(m, inst);
+    } else if constexpr (O == Op::jp) {
+      op_jp(m, inst);
+    } else if constexpr (O == Op::call) {
+      op_call(m, inst);
+    } else if constexpr (O == Op::se_vx_nn) {
+      op_se_vx_nn(m, inst);
+    } else if constexpr (O == Op::sne_vx_nn) {
+      op_sne_vx_nn(m, inst);
+    } else if constexpr (O == Op::se_vx_vy) {
+      op_se_vx_vy(m, inst);
+    } else if constexpr (O == Op::ld_vx_nn) {
+      op_ld_vx_nn(m, inst);
+    } else if constexpr (O == Op::add_vx_nn) {
+      op_add_vx_nn(m, inst);
+    } else if constexpr (O == Op::ld_vx_vy) {
+      op_ld_vx_vy(m, inst);
+    } else if constexpr (O == Op::or_vx_vy) {
+      op_or_vx_vy(m, inst);
+    } else if constexpr (O == Op::and_vx_vy) {
+      op_and_vx_vy(m, inst);
+    } else if constexpr (O == Op::xor_vx_vy) {
+      op_xor_vx_vy(m, inst);
+    } else if constexpr (O == Op::add_vx_vy) {
+      op_add_vx_vy(m, inst);
+    } else if constexpr (O == Op::sub_vx_vy) {
+      op_sub_vx_vy(m, inst);
+    } else if constexpr (O == Op::shr_vx_vy) {
+      op_shr_vx_vy(m, inst);
+    } else if constexpr (O == Op::subn_vx_vy) {
+      op_subn_vx_vy(m, inst);
+    } else if constexpr (O == Op::shl_vx_vy) {
+      op_shl_vx_vy(m, inst);
+    } else if constexpr (O == Op::sne_vx_vy) {
+      op_sne_vx_vy(m, inst);
+    } else if constexpr (O == Op::ld_i_addr) {
+      op_ld_i_addr(m, inst);
+    } else if constexpr (O == Op::jp_v0_addr) {
+      op_jp_v0_addr(m, inst);
+    } else if constexpr (O == Op::rnd_vx_nn) {
+      op_rnd_vx_nn(m, inst);
+    } else if constexpr (O == Op::drw_vx_vy_n) {
+      op_drw_vx_vy_n(m, inst);
+    } else if constexpr (O == Op::skp_vx) {
+      op_skp_vx(m, inst);
+    } else if constexpr (O == Op::sknp_vx) {
+      op_sknp_vx(m, inst);
+    } else if constexpr (O == Op::ld_vx_dt) {
+      op_ld_vx_dt(m, inst);
+    } else if constexpr (O == Op::ld_vx_k) {
+      op_ld_vx_k(m, inst);
+    } else if constexpr (O == Op::ld_dt_vx) {
+      op_ld_dt_vx(m, inst);
+    } else if constexpr (O == Op::ld_st_vx) {
+      op_ld_st_vx(m, inst);
+    } else if constexpr (O == Op::add_i_vx) {
+      op_add_i_vx(m, inst);
+    } else if constexpr (O == Op::ld_f_vx) {
+      op_ld_f_vx(m, inst);
+    } else if constexpr (O == Op::ld_b_vx) {
+      op_ld_b_vx(m, inst);
+    } else if constexpr (O == Op::ld_mem_vx) {
+      op_ld_mem_vx(m, inst);
+    } else if constexpr (O == Op::ld_vx_mem) {
+      op_ld_vx_mem(m, inst);
+    } else if constexpr (O == Op::ld_audio_i) {
+      op_ld_audio_i(m, inst);
+    } else if constexpr (O == Op::ld_pitch_vx) {
+      op_ld_pitch_vx(m, inst);
+    }
+  }
+
+  // Run decoded instruction on machine m.
+  template <typename M>
+  [[gnu::always_inline]] static void execute(M m, const Instruction& inst) {
+    visit(inst.op, [&]<Op O>() { execute<O>(m, inst); });
+  }
+
+  // Unchecked machines skip unknown opcodes after the trap.
+  template <typename M>
+  static void op_unknown(M m, const Instruction& /*inst*/) {
+    m.fault(memory::Fault::unknown_opcode);
+    m.pc() += 2;
+  }
+
+  // CLS
+  template <typename M>
+  static void op_cls(M m, const Instruction& /*inst*/) {
+    m.gfx().clear_screen();
+    m.pc() += 2;
+  }
+
+  // RET
+  template <typename M>
+  static void op_ret(M m, const Instruction& /*inst*/) {
+    m.on_return();
+    if (m.sp() == 0) [[unlikely]] {
+      m.fault(memory::Fault::stack_underflow);
+    }
+    --m.sp();
+    m.pc() = m.stack(m.sp());
+    m.pc() += 2;
+  }
+
+  // JMP
+  template <typename M>
+  static void op_jp(M m, const Instruction& inst) { m.pc() = inst.nnn; }
+
+  // CALL
+  template <typename M>
+  static void op_call(M m, const Instruction& inst) {
+    m.on_call(inst.nnn);
+    if (m.sp() >= stack_size) [[unlikely]] {
+      m.fault(memory::Fault::stack_overflow);
+    }
+    m.stack(m.sp()) = m.pc();
+    ++m.sp();
+    m.pc() = inst.nnn;
+  }
+
+  // SE VX,NN
+  template <typename M>
+  static void op_se_vx_nn(M m, const Instruction& inst) {
+    if (m.reg(inst.x) == inst.nn) {
+      m.pc() += 4;
+    } else {
+      m.pc() += 2;
+    }
+  }
+
+  // SNE VX,NN
+  template <typename M>
+  static void op_sne_vx_nn(M m, const Instruction& inst) {
+    if (m.reg(inst.x) != inst.nn) {
+      m.pc() += 4;
+    } else {
+      m.pc() += 2;
+    }
+  }
+
+  // SE VX,VY
+  template <typename M>
+  static void op_se_vx_vy(M m, const Instruction& inst) {
+    if (m.reg(inst.x) == m.reg(inst.y)) {
+      m.pc() += 4;
+    } else {
+      m.pc() += 2;
+    }
+  }
+
+  // LD Vx,NN
+  template <typename M>
+  static void op_ld_vx_nn(M m, const Instruction& inst) {
+    m.reg(inst.x) = inst.nn;
+    m.pc() += 2;
+  }
+
+  // ADD Vx,NN
+  template <typename M>
+  static void op_add_vx_nn(M m, const Instruction& inst) {
+    m.reg(inst.x) += inst.nn;
+    m.pc() += 2;
+  }
+
+  // LD Vx,Vy
+  template <typename M>
+  static void op_ld_vx_vy(M m, const Instruction& inst) {
+    m.reg(inst.x) = m.reg(inst.y);
+    m.pc() += 2;
+  }
+
+  // OR Vx,Vy
+  template <typename M>
+  static void op_or_vx_vy(M m, const Instruction& inst) {
+    m.reg(inst.x) |= m.reg(inst.y);
+    if constexpr (Quirks::vf_reset) {
+      m.reg(0xF) = 0;
+    }
+    m.pc() += 2;
+  }
+
+  // AND Vx,Vy
+  template <typename M>
+  static void op_and_vx_vy(M m, const Instruction& inst) {
+    m.reg(inst.x) &= m.reg(inst.y);
+    if constexpr (Quirks::vf_reset) {
+      m.reg(0xF) = 0;
+    }
+    m.pc() += 2;
+  }
+
+  // XOR Vx,Vy
+  template <typename M>
+  static void op_xor_vx_vy(M m, const Instruction& inst) {
+    m.reg(inst.x) ^= m.reg(inst.y);
+    if constexpr (Quirks::vf_reset) {
+      m.reg(0xF) = 0;
+    }
+    m.pc() += 2;
+  }
+
+  // ADD Vx,Vy
+  template <typename M>
+  static void op_add_vx_vy(M m, const Instruction& inst) {
+    auto res{m.reg(inst.x) + m.reg(inst.y)};
+
+    m.reg(inst.x) = res;
+    m.reg(0xF) = res > 255 ? 1 : 0;
+
+    m.pc() += 2;
+  }
+
+  // SUB Vx,Vy
+  template <typename M>
+  static void op_sub_vx_vy(M m, const Instruction& inst) {
+    auto res{m.reg(inst.x) - m.reg(inst.y)};
+
+    auto cmp{m.reg(inst.x) > m.reg(inst.y)};
+    m.reg(inst.x) = res;
+    m.reg(0xF) = cmp ? 1 : 0;
+
+    m.pc() += 2;
+  }
+
+  // SHR Vx,[Vy]
+  template <typename M>
+  static void op_shr_vx_vy(M m, const Instruction& inst) {
+    auto source{m.reg(Quirks::shift_uses_vy ? inst.y : inst.x)};
+    auto lsb{source & 0b00000001};
+    m.reg(inst.x) = source >> 1;
+    m.reg(0xF) = lsb;
+
+    m.pc() += 2;
+  }
+
+  // SUBN Vx,Vy
+  template <typename M>
+  static void op_subn_vx_vy(M m, const Instruction& inst) {
+    auto res{m.reg(inst.y) - m.reg(inst.x)};
+
+    auto cmp{m.reg(inst.y) > m.reg(inst.x)};
+    m.reg(inst.x) = res;
+    m.reg(0xF) = cmp ? 1 : 0;
+
+    m.pc() += 2;
+  }
+
+  // SHL Vx,[Vy]
+  template <typename M>
+  static void op_shl_vx_vy(M m, const Instruction& inst) {
+    auto source{m.reg(Quirks::shift_uses_vy ? inst.y : inst.x)};
+    auto msb{source & 0b10000000};
+    m.reg(inst.x) = source << 1;
+    m.reg(0xF) = msb > 0 ? 1 : 0;
+
+    m.pc() += 2;
+  }
+
+  // SNE Vx,Vy
+  template <typename M>
+  static void op_sne_vx_vy(M m, const Instruction& inst) {
+    if (m.reg(inst.x) != m.reg(inst.y)) {
+      m.pc() += 4;
+    } else {
+      m.pc() += 2;
+    }
+  }
+
+  // LD I,addr
+  template <typename M>
+  static void op_ld_i_addr(M m, const Instruction& inst) {
+    m.ir() = inst.nnn;
+    m.pc() += 2;
+  }
+
+  // JP V0,addr
+  template <typename M>
+  static void op_jp_v0_addr(M m, const Instruction& inst) {
+    m.pc() = inst.nnn + m.reg(Quirks::jump_uses_v0 ? 0 : inst.x);
+  }
+
+  // RND Vx,nn
+  template <typename M>
+  static void op_rnd_vx_nn(M m, const Instruction& inst) {
+    m.reg(inst.x) = static_cast<uint8_t>(m.rng()() >> 24) & inst.nn;
+    m.pc() += 2;
+  }
+
+  // DRW Vx,Vy,n
+  template <typename M>
+  static void op_drw_vx_vy_n(M m, const Instruction& inst) {
+    std::array<uint8_t, 0xF> wrapped;
+    std::span<const uint8_t> sprite;
+    if (!check_range(m, m.ir(), inst.n)) {
+      for (std::size_t i = 0; i < inst.n; ++i) {
+        wrapped[i] = m.mem(m.ir() + i);
+      }
+      sprite = std::span<const uint8_t>{wrapped}.first(inst.n);
+    } else {
+      sprite = memory::view(m.ram(), m.ir(), inst.n, wrapped);
+    }
+    auto collision{m.gfx().template draw_sprite<Quirks::wrap_sprites>(m.reg(inst.x), m.reg(inst.y), sprite)};
+    m.reg(0xF) = collision ? 1 : 0;
+
+    m.pc() += 2;
+  }
+
+  // SKP Vx
+  template <typename M>
+  static void op_skp_vx(M m, const Instruction& inst) {
+    if (key_pressed(m, m.reg(inst.x))) {
+      m.pc() += 2;
+    }
+    m.pc() += 2;
+  }
+
+  // SKNP Vx
+  template <typename M>
+  static void op_sknp_vx(M m, const Instruction& inst) {
+    if (!key_pressed(m, m.reg(inst.x))) {
+      m.pc() += 2;
+    }
+    m.pc() += 2;
+  }
+
+  // LD Vx,DT
+  template <typename M>
+  static void op_ld_vx_dt(M m, const Instruction& inst) {
+    m.reg(inst.x) = m.dt();
+    m.pc() += 2;
+  }
+
+  // LD Vx,K
+  template <typename M>
+  static void op_ld_vx_k(M m, const Instruction& inst) {
+    auto keys{m.key_mask()};
+    if (keys == 0) {
+      return;
+    }
+
+    m.reg(inst.x) = static_cast<uint8_t>(std::countr_zero(keys));
+
+    m.pc() += 2;
+  }
+
+  // LD DT,Vx
+  template <typename M>
+  static void op_ld_dt_vx(M m, const Instruction& inst) {
+    m.dt() = m.reg(inst.x);
+    m.pc() += 2;
+  }
+
+  // LD ST,Vx
+  template <typename M>
+  static void op_ld_st_vx(M m, const Instruction& inst) {
+    m.st() = m.reg(inst.x);
+    m.pc() += 2;
+    // Start playing sound.
+    if (m.st() > 0) {
+      m.audio().play();
+    }
+  }
+
+  // ADD I,Vx
+  template <typename M>
+  static void op_add_i_vx(M m, const Instruction& inst) {
+    m.ir() += m.reg(inst.x);
+    m.pc() += 2;
+  }
+
+  // LD F, Vx
+  template <typename M>
+  static void op_ld_f_vx(M m, const Instruction& inst) {
+    m.ir() = m.reg(inst.x) * 0x5;
+    m.pc() += 2;
+  }
+
+  // LD B, Vx
+  template <typename M>
+  static void op_ld_b_vx(M m, const Instruction& inst) {
+    check_range(m, m.ir(), 3);
+    auto value{m.reg(inst.x)};
+    m.write_ram(m.ir(), value / 100);
+    m.write_ram(m.ir() + 1, (value / 10) % 10);
+    m.write_ram(m.ir() + 2, (value % 100) % 10);
+
+    m.pc() += 2;
+  }
+
+  // LD [I],Vx
+  template <typename M>
+  static void op_ld_mem_vx(M m, const Instruction& inst) {
+    const auto count{inst.x + 1U};
+    if (check_range(m, m.ir(), count)) {
+      if constexpr (requires { m.registers(); }) {
+        m.write_ram(m.ir(), std::span<const uint8_t>{m.registers()}.first(count));
+      } else {
+        std::array<uint8_t, 16> values;
+        for (std::size_t i = 0; i < count; ++i) {
+          values[i] = m.reg(i);
+        }
+        m.write_ram(m.ir(), std::span<const uint8_t>{values}.first(count));
+      }
+    } else {
+      for (std::size_t i = 0; i < count; ++i) {
+        m.write_ram(m.ir() + i, m.reg(i));
+      }
+    }
+    if constexpr (Quirks::memory_increments_i) {
+      m.ir() += inst.x + 1;
+    }
+
+    m.pc() += 2;
+  }
+
+  // LD Vx,[I]
+  template <typename M>
+  static void op_ld_vx_mem(M m, const Instruction& inst) {
+    const auto count{inst.x + 1U};
+    if (check_range(m, m.ir(), count)) {
+      std::array<uint8_t, 16> buffer;
+      auto values{memory::view(m.ram(), m.ir(), count, buffer)};
+      if constexpr (requires { m.registers(); }) {
+        std::copy(values.begin(), values.end(), m.registers().begin());
+      } else {
+        for (std::size_t i = 0; i < count; ++i) {
+          m.reg(i) = values[i];
+        }
+      }
+    } else {
+      for (std::size_t i = 0; i < count; ++i) {
+        m.reg(i) = m.mem(m.ir() + i);
+      }
+    }
+    if constexpr (Quirks::memory_increments_i) {
+      m.ir() += inst.x + 1;
+    }
+
+    m.pc() += 2;
+  }
+
+  // LD AUDIO,[I] (XO-CHIP F002)
+  template <typename M>
+  static void op_ld_audio_i(M m, const Instruction& /*inst*/) {
+    if (check_range(m, m.ir(), m.audio_pattern().size())) {
+      std::array<uint8_t, 16> buffer;
+      auto values{memory::view(m.ram(), m.ir(), buffer.size(), buffer)};
+      std::copy(values.begin(), values.end(), m.audio_pattern().begin());
+    } else {
+      for (std::size_t i = 0; i < m.audio_pattern().size(); ++i) {
+        m.audio_pattern()[i] = m.mem(m.ir() + i);
+      }
+    }
+    m.audio().set_pattern(m.audio_pattern());
+    m.pc() += 2;
+  }
+
+  // LD PITCH,Vx (XO-CHIP Fx3A)
+  template <typename M>
+  static void op_ld_pitch_vx(M m, const Instruction& inst) {
+    m.pitch() = m.reg(inst.x);
+    m.audio().set_pitch(m.pitch());
+    m.pc() += 2;
+  }
+
+ private:
+  // Entries of the call stack.
+  static constexpr std::size_t stack_size{16};
+
+  // Whether RAM [address, address + length) is within RAM, faulting if not.
+  template <typename M>
+  static bool check_range(M m, std::size_t address, std::size_t length) {
+    if (address + length > m.ram().size()) [[unlikely]] {
+      m.fault(memory::Fault::address_out_of_range);
+      return false;
+    }
+    return true;
+  }
+
+  // Whether given key is pressed, faulting if there is no such key. Unchecked
+  // machines then look up the key in its low nibble.
+  template <typename M>
+  static bool key_pressed(M m, uint8_t key) {
+    if (key > 0xF) [[unlikely]] {
+      m.fault(memory::Fault::address_out_of_range);
+    }
+    return (m.key_mask() >> (key & 0xF) & 1U) != 0;
+  }
+};
+
+}  // namespace isa
@@ -0,0 +1,371 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+
+#include "chip8.h"
+#include "fonts.h"
+#include "instructions.h"
+#include "memory.h"
+#include "profiler.h"
+#include "quirks.h"
+#include "random.h"
+#include "sdl.h"
+
+// Many machines running the same game in lockstep, for search and training
+// workloads where copies differ only in keys and seed.
+//
+// Registers, PC, I, SP, stack, timers and cycle counts are stored structure of
+// arrays, one element per lane. Lanes at the same PC and opcode form a group
+// sharing one decode and one dispatch, and the handler Chip8 runs for the
+// instruction is inlined into a loop over the lanes of the group. If the group
+// holds every lane and the instruction is arithmetic, a skip, a load of an
+// immediate or a jump, the loop has no masks nor fault handling and the
+// compiler vectorizes it over the arrays. Other instructions, touching per-lane
+// state or able to fault, run lane by lane. When lanes diverge, the ones at the
+// lowest PC run first while the others wait, so they usually meet again at the
+// next join or backward jump. RAM, framebuffer, random number generator, audio
+// state and profiler are kept per lane.
+//
+// Behaves as Chip8 with the same Quirks, Profiler and Memory, except that a
+// fault stops only the faulting lane. With checked memory the lane stops
+// before the faulting instruction changes anything, as Chip8 throws. With
+// unchecked memory it stops after the instruction ran as Chip8 runs it past
+// the trap.
+template <std::size_t Lanes, typename Quirks = quirks::CosmacVip, typename Profiler = NullProfiler,
+          typename Memory = memory::Checked>
+class Lockstep {
+  static_assert(Lanes > 0);
+
+ public:
+  using Snapshot = ::Snapshot<Pcg32>;
+
+  static constexpr std::size_t lanes{Lanes};
+
+  Lockstep() {
+    pc_.fill(0x200);
+    for (auto& machine : machines_) {
+      memory::write(machine.ram, 0, fonts);
+    }
+  }
+
+  // Copy game to RAM of every lane.
+  void load(std::span<const uint8_t> game) {
+    const auto pc_offset{0x200};
+    if (game.size() > ram_size - pc_offset) {
+      throw std::length_error("Game too large.");
+    }
+    for (auto& machine : machines_) {
+      memory::write(machine.ram, pc_offset, game);
+    }
+  }
+
+  // Restart random number sequence of given lane from given seed.
+  void seed(std::size_t lane, uint64_t seed) { machines_.at(lane).rng.seed(seed); }
+
+  // Set pressed keys of given lane, bit n set if key n is pressed.
+  void set_keys(std::size_t lane, uint16_t keys) { machines_.at(lane).keys = keys; }
+
+  // Run given number of CPU cycles on every lane.
+  void run(std::size_t cycles) {
+    while (cycles > 0) {
+      const auto chunk{std::min<std::size_t>(cycles, std::numeric_limits<uint16_t>::max())};
+      PerLane<uint16_t> budgets;
+      budgets.fill(static_cast<uint16_t>(chunk));
+      while (step(budgets)) {
+      }
+      cycles -= chunk;
+    }
+  }
+
+  // Decrement delay and sound timers of every lane.
+  void update_timers() {
+    for (std::size_t l = 0; l < Lanes; ++l) {
+      dt_[l] -= dt_[l] > 0 ? 1 : 0;
+      st_[l] -= st_[l] > 0 ? 1 : 0;
+    }
+  }
+
+  // Run one 60 Hz frame: given number of CPU cycles, then a timer tick.
+  void step_frame(std::size_t cycles_per_frame) {
+    run(cycles_per_frame);
+    update_timers();
+  }
+
+  // Whether given lane stopped on a fault.
+  bool faulted(std::size_t lane) const { return faulted_.at(lane) != 0; }
+
+  uint8_t registers(std::size_t lane, uint8_t index) const { return registers_.at(index).at(lane); }
+
+  uint16_t program_counter(std::size_t lane) const { return pc_.at(lane); }
+
+  uint64_t cycles(std::size_t lane) const { return cycles_.at(lane); }
+
+  const std::array<uint64_t, 32>& rows(std::size_t lane) const { return machines_.at(lane).gfx.rows(); }
+
+  const Profiler& profiler(std::size_t lane) const { return machines_.at(lane).profiler; }
+
+  // State of given lane, as taken by Chip8::snapshot().
+  Snapshot snapshot(std::size_t lane) const {
+    const auto& machine{machines_.at(lane)};
+    Snapshot snapshot{};
+    auto& state{snapshot.machine};
+    if constexpr (std::is_same_v<typename Memory::Ram, memory::FlatRam>) {
+      state.ram = machine.ram;
+    } else {
+      state.ram = static_cast<memory::FlatRam>(machine.ram);
+    }
+    for (std::size_t i = 0; i < 16; ++i) {
+      state.registers[i] = registers_[i][lane];
+      state.stack[i] = stack_[i][lane];
+    }
+    state.dt = dt_[lane];
+    state.st = st_[lane];
+    state.ir = ir_[lane];
+    state.pc = pc_[lane];
+    state.sp = sp_[lane];
+    state.rng = machine.rng;
+    state.cycles = cycles_[lane];
+    state.audio_pattern = machine.audio_pattern;
+    state.pitch = machine.pitch;
+    snapshot.framebuffer = machine.gfx.rows();
+    return snapshot;
+  }
+
+ private:
+  using Op = isa::Op;
+  using Ops = isa::Instructions<Quirks>;
+
+  template <typename T>
+  using PerLane = std::array<T, Lanes>;
+  // 1 for lanes taking part in an operation, 0 for the others.
+  using Mask = PerLane<uint8_t>;
+
+  static constexpr std::size_t ram_size{0x1000};
+
+  // Per-lane state that is not accessed in lockstep.
+  struct Machine {
+    typename Memory::Ram ram{};
+    EmptyGfx gfx{};
+    Pcg32 rng{};
+    uint16_t keys{0};
+    std::array<uint8_t, 16> audio_pattern{default_audio_pattern};
+    uint8_t pitch{default_pitch};
+    EmptyAudio audio{};
+    [[no_unique_address]] Profiler profiler{};
+  };
+
+  // One lane as seen by the instruction handlers.
+  struct Lane {
+    Lockstep& lockstep;
+    std::size_t lane;
+
+    uint8_t& reg(std::size_t index) { return Memory::at(lockstep.registers_, index)[lane]; }
+    uint16_t& pc() { return lockstep.pc_[lane]; }
+    uint16_t& ir() { return lockstep.ir_[lane]; }
+    uint8_t& sp() { return lockstep.sp_[lane]; }
+    uint16_t& stack(std::size_t index) { return Memory::at(lockstep.stack_, index)[lane]; }
+    uint8_t& dt() { return lockstep.dt_[lane]; }
+    uint8_t& st() { return lockstep.st_[lane]; }
+    std::array<uint8_t, 16>& audio_pattern() { return machine().audio_pattern; }
+    uint8_t& pitch() { return machine().pitch; }
+
+    const typename Memory::Ram& ram() const { return lockstep.machines_[lane].ram; }
+    uint8_t mem(std::size_t address) const { return Memory::at(ram(), address); }
+    void write_ram(uint16_t address, uint8_t value) { Memory::at(machine().ram, address) = value; }
+    void write_ram(uint16_t address, std::span<const uint8_t> values) {
+      memory::write(machine().ram, address, values);
+    }
+
+    Pcg32& rng() { return machine().rng; }
+    EmptyGfx& gfx() { return machine().gfx; }
+    EmptyAudio& audio() { return machine().audio; }
+    uint16_t key_mask() { return machine().keys; }
+
+    // Stop lane: checked machines throw, unchecked ones finish the instruction.
+    void fault(memory::Fault kind) {
+      if constexpr (Memory::checked) {
+        memory::throw_fault(kind);
+      } else {
+        lockstep.faulted_[lane] = 1;
+      }
+    }
+
+    void on_call(uint16_t address) {
+      if constexpr (Profiler::enabled) {
+        machine().profiler.on_call(address);
+      }
+    }
+
+    void on_return() {
+      if constexpr (Profiler::enabled) {
+        machine().profiler.on_return();
+      }
+    }
+
+    Machine& machine() { return lockstep.machines_[lane]; }
+  };
+
+  std::array<PerLane<uint8_t>, 16> registers_{};
+  PerLane<uint16_t> pc_{};
+  PerLane<uint16_t> ir_{};
+  PerLane<uint8_t> dt_{};
+  PerLane<uint8_t> st_{};
+  PerLane<uint8_t> sp_{};
+  std::array<PerLane<uint16_t>, 16> stack_{};
+  PerLane<uint64_t> cycles_{};
+  Mask faulted_{};
+  // Opcode at PC of every lane, fetched at the start of a step.
+  PerLane<uint16_t> opcodes_{};
+  std::array<Machine, Lanes> machines_{};
+
+  // Run one instruction on lanes that have not faulted nor used up their
+  // budget of cycles. If they are at different instructions, only lanes at
+  // the lowest PC run, so lanes that went ahead on a skip wait for the others
+  // to catch up and groups merge again. Returns false if no lane ran.
+  bool step(PerLane<uint16_t>& budgets) {
+    Mask pending;
+    uint8_t any{0};
+    for (std::size_t l = 0; l < Lanes; ++l) {
+      pending[l] = (faulted_[l] ^ 1U) & static_cast<uint8_t>(budgets[l] != 0);
+      // Fetch of the second opcode byte would be past the end of RAM.
+      const auto past_end{static_cast<uint8_t>(pending[l] & static_cast<uint8_t>(pc_[l] + 1U >= ram_size))};
+      faulted_[l] |= past_end;
+      if constexpr (Memory::checked) {
+        // The fetch faults after the cycle is counted, as in Chip8.
+        cycles_[l] += past_end;
+        pending[l] &= past_end ^ 1U;
+      } else {
+        // The instruction runs from the wrapped PC, then the lane stops.
+        pc_[l] = past_end != 0 ? pc_[l] & (ram_size - 1) : pc_[l];
+      }
+      any |= pending[l];
+    }
+    if (any == 0) {
+      return false;
+    }
+    for (std::size_t l = 0; l < Lanes; ++l) {
+      const auto& ram{machines_[l].ram};
+      // Wrapped, only faulted lanes are out of range.
+      opcodes_[l] = static_cast<uint16_t>(Memory::at(ram, pc_[l] & (ram_size - 1)) << 8 |
+                                          Memory::at(ram, (pc_[l] + 1U) & (ram_size - 1)));
+    }
+
+    // Common case of all lanes at the same instruction, in one pass.
+    uint8_t diverged{0};
+    for (std::size_t l = 0; l < Lanes; ++l) {
+      diverged |= (pending[l] ^ 1U) | static_cast<uint8_t>(pc_[l] != pc_[0]) |
+                  static_cast<uint8_t>(opcodes_[l] != opcodes_[0]);
+    }
+    if (diverged == 0) {
+      execute_group(opcodes_[0], pending, budgets);
+      return true;
+    }
+
+    uint16_t pc{0xFFFF};
+    for (std::size_t l = 0; l < Lanes; ++l) {
+      pc = std::min(pc, pending[l] != 0 ? pc_[l] : uint16_t{0xFFFF});
+    }
+    // Lanes at that PC may still differ in opcode if they wrote their code.
+    for (std::size_t l = 0; l < Lanes; ++l) {
+      pending[l] &= static_cast<uint8_t>(pc_[l] == pc);
+    }
+    for (std::size_t leader = 0; leader < Lanes; ++leader) {
+      if (pending[leader] == 0) {
+        continue;
+      }
+      const auto opcode{opcodes_[leader]};
+      Mask group{};
+      for (std::size_t l = 0; l < Lanes; ++l) {
+        group[l] = pending[l] & static_cast<uint8_t>(opcodes_[l] == opcode);
+        pending[l] &= group[l] ^ 1U;
+      }
+      execute_group(opcode, group, budgets);
+    }
+    return true;
+  }
+
+  // Whether instruction only reads and writes registers, I and PC of its
+  // lane, so it can't fault and lanes can run it at once.
+  static constexpr bool lane_parallel(Op op) {
+    if constexpr (Profiler::enabled) {
+      return false;
+    }
+    switch (op) {
+      case Op::jp:
+      case Op::se_vx_nn:
+      case Op::sne_vx_nn:
+      case Op::se_vx_vy:
+      case Op::ld_vx_nn:
+      case Op::add_vx_nn:
+      case Op::ld_vx_vy:
+      case Op::or_vx_vy:
+      case Op::and_vx_vy:
+      case Op::xor_vx_vy:
+      case Op::add_vx_vy:
+      case Op::sub_vx_vy:
+      case Op::shr_vx_vy:
+      case Op::subn_vx_vy:
+      case Op::shl_vx_vy:
+      case Op::sne_vx_vy:
+      case Op::ld_i_addr: {
+        return true;
+      }
+      default: {
+        return false;
+      }
+    }
+  }
+
+  // Decode opcode once, then run its handler on every lane in group.
+  void execute_group(uint16_t opcode, const Mask& group, PerLane<uint16_t>& budgets) {
+    for (std::size_t l = 0; l < Lanes; ++l) {
+      cycles_[l] += group[l];
+      budgets[l] -= group[l];
+    }
+    const auto inst{Ops::operands(Ops::opcode_table()[opcode], opcode)};
+    isa::visit(inst.op, [&]<Op O>() {
+      if constexpr (lane_parallel(O)) {
+        uint8_t all{1};
+        for (std::size_t l = 0; l < Lanes; ++l) {
+          all &= group[l];
+        }
+        if (all != 0) {
+          // Registers are indexed by nibbles, so no lane can fault.
+          for (std::size_t l = 0; l < Lanes; ++l) {
+            Ops::template execute<O>(Lane{*this, l}, inst);
+          }
+          return;
+        }
+      }
+      for (std::size_t l = 0; l < Lanes; ++l) {
+        if (group[l] != 0) {
+          execute<O>(l, inst);
+        }
+      }
+    });
+  }
+
+  template <Op O>
+  void execute(std::size_t lane, const isa::Instruction& inst) {
+    if constexpr (Profiler::enabled) {
+      machines_[lane].profiler.on_instruction(pc_[lane], opcodes_[lane]);
+    }
+    if constexpr (Memory::checked) {
+      try {
+        Ops::template execute<O>(Lane{*this, lane}, inst);
+      } catch (const std::exception&) {
+        faulted_[lane] = 1;
+      }
+    } else {
+      Ops::template execute<O>(Lane{*this, lane}, inst);
+    }
+  }
+};
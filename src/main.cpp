@@ -1,31 +1,276 @@
 #include <CLI/CLI.hpp>
-#include <thread>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <span>
+#include <sstream>
 
 #include "chip8.h"
+#include "memory.h"
+#include "movie.h"
+#include "profiler.h"
+#include "quirks.h"
+#include "rewind.h"
+#include "rom_archive.h"
 #include "sdl.h"
 #include "timer.h"
 
-int main(int argc, char** argv) {
-  CLI::App app{"Chip8 emulator"};
-  std::string path_to_game = "";
-  app.add_option("-f,--file", path_to_game, "Game path.");
-  int64_t interval = 5;
-  app.add_option("-i,--interval", interval, "Interval between CPU cycles.");
-  CLI11_PARSE(app, argc, argv);
+namespace {
 
-  auto game{load_game(path_to_game)};
+struct Options {
+  std::string path_to_game{};
+  // CPU cycles per 60 Hz frame.
+  int64_t cycles_per_frame{10};
+  // Emulated frames per displayed frame.
+  double speed{1.0};
+  // Run as fast as possible.
+  bool turbo{false};
+  // ROM archive to take the game from, and hash of the game in it.
+  std::string archive{};
+  std::string rom{};
+  // Samples per audio buffer.
+  int64_t audio_buffer{256};
+  std::string overrun{"catch-up"};
+  std::string renderer{"texture"};
+  std::string engine{"interpreter"};
+  std::string quirks{"vip"};
+  std::string profile{};
+  // Seed of the random number generator, random if not given.
+  std::optional<uint64_t> seed{};
+  // Seconds of rewind history, 0 disables rewind.
+  int64_t rewind{300};
+  // Movie file to write key presses to.
+  std::string record{};
+  // Movie file to take key presses and seed from.
+  std::string replay{};
+};
 
-  SdlGfx gfx{1024, 512};
-  SdlInput input;
-  SdlAudio audio;
-  Chip8 chip8{gfx, input, audio};
+// Upper bound of memory used by rewind history.
+const std::size_t rewind_max_bytes{64 << 20};
+
+template <typename Profiler>
+void write_profile(const Profiler& profiler, const std::string& prefix) {
+  if constexpr (Profiler::enabled) {
+    std::ofstream json{prefix + ".json"};
+    profiler.write_json(json);
+    std::ofstream folded{prefix + ".folded"};
+    profiler.write_folded(folded);
+  }
+}
+
+void print_stats(const std::string& name, const TimerStats& stats) {
+  std::cout << name << ": " << stats.ticks << " ticks, " << stats.overruns << " overruns, " << stats.skipped
+            << " skipped, jitter " << stats.mean_jitter.count() << " ns mean, " << stats.max_jitter.count()
+            << " ns max.\n";
+}
+
+// Speed-up of emulated frames over real time, e.g. "2.50x".
+std::string format_speed(uint64_t frames, Pacer::Clock::duration elapsed) {
+  auto seconds{std::chrono::duration<double>(elapsed).count()};
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(2) << static_cast<double>(frames) / 60.0 / seconds << "x";
+  return out.str();
+}
+
+// Run game until the window is closed. Keys come from input, which may wrap sdl_input.
+template <typename Quirks, typename Profiler, typename Gfx, typename Input>
+void emulate(std::span<const uint8_t> game, const Options& options, uint64_t seed, Gfx& gfx,
+             SdlInput& sdl_input, Input& input) {
+  SdlAudio audio{static_cast<int>(options.audio_buffer)};
+  Chip8<Gfx, Input, SdlAudio, Quirks, Profiler, memory::Frontend> chip8{gfx, input, audio};
+  // Faults stop the game in release builds too.
+  chip8.set_trap(memory::throw_fault);
   chip8.load(game);
+  chip8.set_engine(options.engine == "block" ? Engine::block : Engine::interpreter);
+  chip8.seed(seed);
+
+  // Rewinding would desynchronize movies.
+  const bool rewind_enabled{options.rewind > 0 && options.record.empty() && options.replay.empty()};
+  using Machine = decltype(chip8);
+  Rewind<typename Machine::Snapshot> rewind{static_cast<std::size_t>(options.rewind) * 60, rewind_max_bytes};
+  typename Machine::Snapshot snapshot;
+
+  // Display loop: events, then emulated frames or a step back, then present and wait for the next refresh.
+  // Emulated frames per refresh follow the speed multiplier, or fill the whole refresh when unthrottled.
+  Pacer frame_clock{std::chrono::nanoseconds(std::chrono::seconds(1)) / 60,
+                    options.overrun == "skip" ? Overrun::skip : Overrun::catch_up};
+  const auto cycles_per_frame{static_cast<std::size_t>(options.cycles_per_frame)};
+  double frame_budget{0};
+  uint64_t emulated_frames{0};
+  uint64_t total_emulated_frames{0};
+  auto report_start{Pacer::Clock::now()};
+  const auto run_start{report_start};
+
+  auto emulate_frame{[&]() {
+    chip8.step_frame(cycles_per_frame);
+    ++emulated_frames;
+    if (rewind_enabled) {
+      chip8.snapshot(snapshot);
+      rewind.push(snapshot);
+    }
+  }};
+
+  while (sdl_input.emulator_active()) {
+    sdl_input.poll(0);
+
+    if (rewind_enabled && sdl_input.rewind_held()) {
+      if (rewind.step_back(snapshot)) {
+        chip8.restore(snapshot);
+      }
+    } else if (options.turbo || sdl_input.fast_forward_held()) {
+      // Frames waiting for a key change nothing until the next poll, sleep instead.
+      do {
+        emulate_frame();
+      } while (Pacer::Clock::now() < frame_clock.next_tick() && !chip8.waiting_for_input());
+    } else {
+      frame_budget += options.speed;
+      for (; frame_budget >= 1; --frame_budget) {
+        emulate_frame();
+      }
+    }
+    if (sdl_input.take_redraw()) {
+      gfx.redraw();
+    }
+    gfx.present();
+    frame_clock.wait();
 
-  Timer timer_clock{std::chrono::milliseconds(1000 / 60), [&chip8]() { chip8.update_timers(); }};
-  Timer cpu_clock{std::chrono::milliseconds(interval), [&chip8]() { chip8.execute_cycle(); }};
+    // Report speed-up over real time once a second.
+    auto now{Pacer::Clock::now()};
+    if (now - report_start >= std::chrono::seconds(1)) {
+      gfx.set_title("Chip8 - " + format_speed(emulated_frames, now - report_start));
+      total_emulated_frames += emulated_frames;
+      emulated_frames = 0;
+      report_start = now;
+    }
+  }
+  total_emulated_frames += emulated_frames;
+  std::cout << "Speed: " << format_speed(total_emulated_frames, Pacer::Clock::now() - run_start) << ".\n";
+  std::cout << "Idle: " << chip8.skipped_cycles() << " of " << chip8.cycles() << " cycles skipped.\n";
+  print_stats("Frame clock", frame_clock.stats());
+
+  auto latency{audio.latency()};
+  std::cout << "Audio latency: " << latency.buffer.count() << " ns buffer, " << latency.starts << " tone starts, "
+            << latency.mean_start.count() << " ns mean, " << latency.max_start.count() << " ns max to callback.\n";
+
+  write_profile(chip8.profiler(), options.profile);
+
+  if (rewind_enabled) {
+    auto stats{rewind.stats()};
+    std::cout << "Rewind: " << stats.frames << " frames (" << stats.keyframes << " keyframes) in " << stats.bytes
+              << " bytes, " << stats.mean_encode.count() << " ns mean encode per frame.\n";
+  }
+}
+
+template <typename Gfx, typename Quirks, typename Profiler>
+void run(std::span<const uint8_t> game, const Options& options) {
+  Gfx gfx{1024, 512};
+  SdlInput input;
+  auto seed{options.seed.value_or(std::random_device{}())};
+
+  if (!options.replay.empty()) {
+    std::ifstream file{options.replay, std::ios::binary};
+    auto movie{Movie::read(file)};
+    movie.check(fnv1a(game), options.quirks, static_cast<uint64_t>(options.cycles_per_frame));
+    ReplayInput replay{movie};
+    emulate<Quirks, Profiler>(game, options, movie.seed, gfx, input, replay);
+  } else if (!options.record.empty()) {
+    Movie movie{seed, fnv1a(game), options.quirks, static_cast<uint64_t>(options.cycles_per_frame)};
+    RecordingInput<SdlInput> recording{input, movie};
+    emulate<Quirks, Profiler>(game, options, seed, gfx, input, recording);
+    std::ofstream file{options.record, std::ios::binary};
+    movie.write(file);
+  } else {
+    emulate<Quirks, Profiler>(game, options, seed, gfx, input, input);
+  }
+}
+
+template <typename Gfx, typename Quirks>
+void run(std::span<const uint8_t> game, const Options& options) {
+  if (options.profile.empty()) {
+    run<Gfx, Quirks, NullProfiler>(game, options);
+  } else {
+    run<Gfx, Quirks, GuestProfiler>(game, options);
+  }
+}
+
+template <typename Gfx>
+void run(std::span<const uint8_t> game, const Options& options) {
+  if (options.quirks == "schip") {
+    run<Gfx, quirks::SuperChip>(game, options);
+  } else if (options.quirks == "xochip") {
+    run<Gfx, quirks::XoChip>(game, options);
+  } else {
+    run<Gfx, quirks::CosmacVip>(game, options);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  CLI::App app{"Chip8 emulator"};
+  Options options;
+  app.add_option("-f,--file", options.path_to_game, "Game path.");
+  auto* rom_option{
+      app.add_option("--rom", options.rom, "Hash of the game in the ROM archive, as printed by chip8-pack.")};
+  app.add_option("-a,--archive", options.archive, "ROM archive made by chip8-pack, game is chosen with --rom.")
+      ->needs(rom_option);
+  app.add_option("-n,--ipf", options.cycles_per_frame, "CPU cycles per 60 Hz frame.")
+      ->check(CLI::Range(int64_t{1}, int64_t{1'000'000}));
+  app.add_option("--speed", options.speed, "Speed multiplier, emulated frames per displayed frame.")
+      ->check(CLI::Range(0.1, 100.0));
+  app.add_flag("-t,--turbo", options.turbo, "Run as fast as possible. Holding Tab does the same.");
+  app.add_option("--audio-buffer", options.audio_buffer, "Samples per audio buffer, lower has less latency.")
+      ->check(CLI::Range(int64_t{32}, int64_t{8192}));
+  app.add_option("--overrun", options.overrun, "When emulation falls behind: catch-up or skip frames.")
+      ->check(CLI::IsMember({"catch-up", "skip"}));
+  app.add_option("-r,--renderer", options.renderer, "Rendering backend: texture or surface.")
+      ->check(CLI::IsMember({"texture", "surface"}));
+  app.add_option("-e,--engine", options.engine, "Execution engine: interpreter or block.")
+      ->check(CLI::IsMember({"interpreter", "block"}));
+  app.add_option("-q,--quirks", options.quirks, "Quirk profile: vip, schip or xochip.")
+      ->check(CLI::IsMember({"vip", "schip", "xochip"}));
+  app.add_option("-p,--profile", options.profile,
+                 "Profile the game, writing <prefix>.json and <prefix>.folded at exit.");
+  app.add_option("-w,--rewind", options.rewind, "Seconds of rewind history, 0 disables rewind.")
+      ->check(CLI::Range(int64_t{0}, int64_t{3600}));
+  app.add_option("--record", options.record, "Record key presses to a movie file.");
+  app.add_option("--replay", options.replay,
+                 "Replay key presses and seed from a movie file, recorded with the same ROM, quirks and cycles per "
+                 "frame.");
+  uint64_t seed{};
+  auto* seed_option{app.add_option("-s,--seed", seed, "Seed of the random number generator.")};
+  CLI11_PARSE(app, argc, argv);
+  if (*seed_option) {
+    options.seed = seed;
+  }
 
-  std::mutex exit_mutex;
-  std::unique_lock<std::mutex> exit_lock{exit_mutex};
+  try {
+    std::vector<uint8_t> game_file;
+    std::optional<RomArchive> archive;
+    std::span<const uint8_t> game;
+    if (!options.archive.empty()) {
+      const auto hash{parse_rom_hash(options.rom)};
+      archive.emplace(options.archive);
+      auto rom{archive->find(hash)};
+      if (!rom) {
+        std::cerr << "ROM " << options.rom << " not found in " << options.archive << "\n";
+        return 1;
+      }
+      game = *rom;
+    } else {
+      game_file = load_game(options.path_to_game);
+      game = game_file;
+    }
 
-  input.emulator_active_cv().wait(exit_lock, [&input] { return !input.emulator_active(); });
-}
\ No newline at end of file
+    if (options.renderer == "surface") {
+      run<SdlGfx>(game, options);
+    } else {
+      run<SdlTextureGfx>(game, options);
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+  }
+}
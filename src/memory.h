@@ -0,0 +1,115 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+#include "paged_ram.h"
+
+// Memory policies, selected with the Memory parameter of Chip8. They decide
+// how RAM, register and stack accesses are bounds-checked, how programs doing
+// something invalid are stopped and how RAM is stored.
+namespace memory {
+
+// Invalid things a program can do.
+enum class Fault : uint8_t {
+  // Opcode not known to the selected quirk profile.
+  unknown_opcode,
+  // RAM access, or instruction fetch, past the end of RAM.
+  address_out_of_range,
+  // CALL with all stack entries used.
+  stack_overflow,
+  // RET with an empty stack.
+  stack_underflow,
+};
+
+// Throw what a checked machine throws on given fault. Set as the trap of an
+// unchecked machine, stops it on the first fault the same way.
+[[noreturn]] inline void throw_fault(Fault kind, uint16_t /*pc*/ = 0) {
+  switch (kind) {
+    case Fault::address_out_of_range: {
+      throw std::out_of_range("Address out of memory bounds.");
+    }
+    case Fault::stack_overflow: {
+      throw std::out_of_range("Stack overflow.");
+    }
+    case Fault::stack_underflow: {
+      throw std::out_of_range("Stack underflow.");
+    }
+    case Fault::unknown_opcode: {
+      break;
+    }
+  }
+  throw std::runtime_error("Unknown opcode.");
+}
+
+// Every access is bounds-checked and faults throw. Default, for development
+// and tests.
+struct Checked {
+  static constexpr bool checked{true};
+  static constexpr bool copy_on_write{false};
+  using Ram = FlatRam;
+
+  template <typename T, std::size_t N>
+  static T& at(std::array<T, N>& array, std::size_t index) {
+    return array.at(index);
+  }
+
+  template <typename T, std::size_t N>
+  static const T& at(const std::array<T, N>& array, std::size_t index) {
+    return array.at(index);
+  }
+};
+
+// Indices are wrapped to the array size, addresses to 12 bits and register
+// indices to 4 bits, so no access can leave its array and none is checked.
+// Faults are reported to the trap callback of Chip8 instead of throwing, then
+// execution continues with the wrapped access. For release builds.
+struct Unchecked {
+  static constexpr bool checked{false};
+  static constexpr bool copy_on_write{false};
+  using Ram = FlatRam;
+
+  template <typename T, std::size_t N>
+  static T& at(std::array<T, N>& array, std::size_t index) {
+    static_assert(std::has_single_bit(N));
+    return array[index & (N - 1)];
+  }
+
+  template <typename T, std::size_t N>
+  static const T& at(const std::array<T, N>& array, std::size_t index) {
+    static_assert(std::has_single_bit(N));
+    return array[index & (N - 1)];
+  }
+};
+
+// Checked accesses to RAM in copy-on-write pages, so Chip8::fork() shares RAM
+// with the original until either writes it. Instructions are decoded on every
+// fetch, as caching them per machine would cost more than the RAM. For tree
+// search and other uses keeping many copies of a machine.
+struct CopyOnWrite : Checked {
+  static constexpr bool copy_on_write{true};
+  using Ram = PagedRam;
+
+  using Checked::at;
+
+  static uint8_t& at(PagedRam& ram, std::size_t index) {
+    // Throws before a page is copied.
+    ram.at(index);
+    return ram.writable(index);
+  }
+
+  static const uint8_t& at(const PagedRam& ram, std::size_t index) { return ram.at(index); }
+};
+
+// Policy of the emulator, batch runner and VecEnv: unchecked in release
+// builds, with memory::throw_fault() as the trap, checked otherwise.
+#ifdef NDEBUG
+using Frontend = Unchecked;
+#else
+using Frontend = Checked;
+#endif
+
+}  // namespace memory
@@ -0,0 +1,113 @@
+#include "movie.h"
+
+#include <array>
+#include <stdexcept>
+
+namespace {
+
+constexpr std::array<char, 4> magic{'C', '8', 'M', 'V'};
+constexpr uint32_t version{2};
+
+void write_le(std::ostream& out, uint64_t value, std::size_t size) {
+  for (std::size_t i = 0; i < size; ++i) {
+    out.put(static_cast<char>((value >> (8 * i)) & 0xFF));
+  }
+}
+
+uint64_t read_le(std::istream& in, std::size_t size) {
+  uint64_t value{0};
+  for (std::size_t i = 0; i < size; ++i) {
+    value |= static_cast<uint64_t>(static_cast<uint8_t>(in.get())) << (8 * i);
+  }
+  return value;
+}
+
+void write_leb128(std::ostream& out, uint64_t value) {
+  do {
+    auto byte{static_cast<uint8_t>(value & 0x7F)};
+    value >>= 7;
+    if (value != 0) {
+      byte |= 0x80;
+    }
+    out.put(static_cast<char>(byte));
+  } while (value != 0);
+}
+
+uint64_t read_leb128(std::istream& in) {
+  uint64_t value{0};
+  for (int shift = 0; shift < 64; shift += 7) {
+    auto byte{static_cast<uint8_t>(in.get())};
+    value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      break;
+    }
+  }
+  return value;
+}
+
+}  // namespace
+
+void Movie::write(std::ostream& out) const {
+  out.write(magic.data(), magic.size());
+  write_le(out, version, 4);
+  write_le(out, seed, 8);
+  write_le(out, rom_hash, 8);
+  write_le(out, cycles_per_frame, 4);
+  write_le(out, quirks.size(), 1);
+  out.write(quirks.data(), static_cast<std::streamsize>(quirks.size()));
+
+  uint64_t cycle{0};
+  for (const auto& event : events) {
+    write_leb128(out, event.cycle - cycle);
+    write_le(out, event.keys, 2);
+    cycle = event.cycle;
+  }
+}
+
+Movie Movie::read(std::istream& in) {
+  std::array<char, 4> file_magic{};
+  in.read(file_magic.data(), file_magic.size());
+  auto file_version{read_le(in, 4)};
+  Movie movie{};
+  if (!in) {
+    throw std::runtime_error("Truncated movie.");
+  }
+  if (file_magic != magic) {
+    throw std::runtime_error("Not a movie.");
+  }
+  if (file_version != version) {
+    throw std::runtime_error("Unsupported movie version.");
+  }
+  movie.seed = read_le(in, 8);
+  movie.rom_hash = read_le(in, 8);
+  movie.cycles_per_frame = read_le(in, 4);
+  movie.quirks.resize(read_le(in, 1));
+  in.read(movie.quirks.data(), static_cast<std::streamsize>(movie.quirks.size()));
+  if (!in) {
+    throw std::runtime_error("Truncated movie.");
+  }
+
+  uint64_t cycle{0};
+  while (in.peek() != std::istream::traits_type::eof()) {
+    cycle += read_leb128(in);
+    auto keys{static_cast<uint16_t>(read_le(in, 2))};
+    if (!in) {
+      throw std::runtime_error("Truncated movie.");
+    }
+    movie.events.push_back({cycle, keys});
+  }
+  return movie;
+}
+
+void Movie::check(uint64_t rom_hash, const std::string& quirks, uint64_t cycles_per_frame) const {
+  if (rom_hash != this->rom_hash) {
+    throw std::runtime_error("Movie was recorded with another ROM.");
+  }
+  if (quirks != this->quirks) {
+    throw std::runtime_error("Movie was recorded with quirk profile " + this->quirks + ".");
+  }
+  if (cycles_per_frame != this->cycles_per_frame) {
+    throw std::runtime_error("Movie was recorded at " + std::to_string(this->cycles_per_frame) +
+                             " cycles per frame.");
+  }
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Key state changes of a session, keyed by the cycle they were read at.
+// Replayed with the same ROM, quirks and seed, a movie reproduces the
+// session exactly, regardless of execution engine.
+struct Movie {
+  struct Event {
+    uint64_t cycle;
+    // Bit n set if key n is pressed.
+    uint16_t keys;
+
+    bool operator==(const Event&) const = default;
+  };
+
+  // Seed of the random number generator of the recorded session.
+  uint64_t seed{0};
+  // FNV-1a hash of the ROM, quirk profile name and CPU cycles per frame the
+  // session ran with.
+  uint64_t rom_hash{0};
+  std::string quirks{};
+  uint64_t cycles_per_frame{0};
+  // Ordered by cycle.
+  std::vector<Event> events{};
+
+  bool operator==(const Movie&) const = default;
+
+  // Write as "C8MV" magic, 32-bit version, 64-bit seed, 64-bit ROM hash,
+  // 32-bit cycles per frame and quirk profile name prefixed by its 8-bit
+  // length, followed by one record per event: cycles since the previous event
+  // as LEB128, then the 16-bit key mask. All fields are little-endian.
+  void write(std::ostream& out) const;
+
+  // Read movie written by write(). Throws std::runtime_error if stream is
+  // not a movie of this version or is truncated.
+  static Movie read(std::istream& in);
+
+  // Throws std::runtime_error unless the session is run with the recorded
+  // ROM, quirk profile and cycles per frame, as the replay desynchronizes
+  // otherwise.
+  void check(uint64_t rom_hash, const std::string& quirks, uint64_t cycles_per_frame) const;
+};
+
+// Input adapter logging key state changes of wrapped input into a movie.
+template <typename Input>
+class RecordingInput {
+ public:
+  RecordingInput(Input& input, Movie& movie) : input_{input}, movie_{movie} {}
+
+  // Set by Chip8 before every key_mask().
+  void set_cycle(uint64_t cycle) { cycle_ = cycle; }
+
+  uint16_t key_mask() {
+    auto keys{input_.key_mask()};
+    if (keys != keys_) {
+      movie_.events.push_back({cycle_, keys});
+      keys_ = keys;
+    }
+    return keys;
+  }
+
+  // Cycle of the next key change, if wrapped input knows it. Keys of other
+  // inputs only change between runs of the machine.
+  uint64_t next_key_change() const {
+    if constexpr (requires { input_.next_key_change(); }) {
+      return input_.next_key_change();
+    }
+    return std::numeric_limits<uint64_t>::max();
+  }
+
+ private:
+  Input& input_;
+  Movie& movie_;
+  uint64_t cycle_{0};
+  uint16_t keys_{0};
+};
+
+// Input feeding key state from a movie.
+class ReplayInput {
+ public:
+  explicit ReplayInput(const Movie& movie) : movie_{movie} {}
+
+  // Set by Chip8 before every key_mask().
+  void set_cycle(uint64_t cycle) {
+    while (next_ < movie_.events.size() && movie_.events[next_].cycle <= cycle) {
+      keys_ = movie_.events[next_].keys;
+      ++next_;
+    }
+  }
+
+  uint16_t key_mask() const { return keys_; }
+
+  // Cycle of the next key change, never if all events were replayed.
+  uint64_t next_key_change() const {
+    return finished() ? std::numeric_limits<uint64_t>::max() : movie_.events[next_].cycle;
+  }
+
+  // Whether all events were replayed.
+  bool finished() const { return next_ == movie_.events.size(); }
+
+ private:
+  const Movie& movie_;
+  std::size_t next_{0};
+  uint16_t keys_{0};
+};
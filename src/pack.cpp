@@ -0,0 +1,38 @@
+#include <CLI/CLI.hpp>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#include "game.h"
+#include "rom_archive.h"
+
+// Packs ROM files into an archive for Chip8 -a, printing the hash of each ROM.
+int main(int argc, char** argv) {
+  CLI::App app{"Chip8 ROM archive packer"};
+  std::string output{};
+  std::vector<std::string> paths{};
+  app.add_option("-o,--output", output, "Archive path.")->required();
+  app.add_option("roms", paths, "ROM files.")->required();
+  CLI11_PARSE(app, argc, argv);
+
+  try {
+    std::vector<std::vector<uint8_t>> roms;
+    for (const auto& path : paths) {
+      roms.push_back(load_game(path));
+      std::cout << std::hex << std::setw(16) << std::setfill('0') << fnv1a(roms.back()) << "  " << path << "\n";
+    }
+    // Opening the output truncates it, so an existing archive is kept if the
+    // new one would not fit.
+    rom_archive_offsets(roms);
+
+    std::ofstream file{output, std::ios::binary};
+    write_rom_archive(file, roms);
+    if (!file) {
+      std::cerr << "Failed to write " << output << "\n";
+      return 1;
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+  }
+}
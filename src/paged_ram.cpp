@@ -0,0 +1,82 @@
+#include "paged_ram.h"
+
+namespace memory {
+
+PagedRam::PagedRam() {
+  static const auto zero{std::make_shared<Page>()};
+  pages_.fill(zero);
+}
+
+PagedRam::PagedRam(const FlatRam& ram) { write(0, ram); }
+
+PagedRam::operator FlatRam() const {
+  FlatRam ram{};
+  for (std::size_t i = 0; i < page_count; ++i) {
+    std::copy(pages_[i]->bytes.begin(), pages_[i]->bytes.end(), ram.begin() + i * page_size);
+  }
+  return ram;
+}
+
+std::span<const uint8_t> PagedRam::view(std::size_t address, std::size_t length, std::span<uint8_t> buffer) const {
+  const auto offset{address % page_size};
+  if (offset + length <= page_size) {
+    return std::span<const uint8_t>{pages_[address / page_size]->bytes}.subspan(offset, length);
+  }
+  for (std::size_t i = 0; i < length; ++i) {
+    buffer[i] = (*this)[address + i];
+  }
+  return buffer.first(length);
+}
+
+void PagedRam::write(std::size_t address, std::span<const uint8_t> values) {
+  while (!values.empty()) {
+    const auto offset{address % page_size};
+    const auto count{std::min(values.size(), page_size - offset)};
+    auto& page{pages_[address / page_size]};
+    if (!page || page.use_count() > 1) {
+      // Whole page overwritten, nothing to copy.
+      if (!page || count == page_size) {
+        page = std::make_shared<Page>();
+      } else {
+        unshare(page);
+      }
+    } else {
+      std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    std::copy_n(values.begin(), count, page->bytes.begin() + offset);
+    address += count;
+    values = values.subspan(count);
+  }
+}
+
+std::size_t PagedRam::unshared_bytes() const {
+  std::size_t bytes{0};
+  for (const auto& page : pages_) {
+    if (page.use_count() == 1) {
+      bytes += sizeof(Page);
+    }
+  }
+  return bytes;
+}
+
+bool PagedRam::operator==(const PagedRam& other) const {
+  for (std::size_t i = 0; i < page_count; ++i) {
+    if (pages_[i] != other.pages_[i] && pages_[i]->bytes != other.pages_[i]->bytes) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool PagedRam::operator==(const FlatRam& other) const {
+  for (std::size_t i = 0; i < page_count; ++i) {
+    if (!std::equal(pages_[i]->bytes.begin(), pages_[i]->bytes.end(), other.begin() + i * page_size)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void PagedRam::unshare(std::shared_ptr<Page>& page) { page = std::make_shared<Page>(*page); }
+
+}  // namespace memory
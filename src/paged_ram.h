@@ -0,0 +1,100 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <stdexcept>
+
+namespace memory {
+
+// RAM as one array, copied whole with the machine.
+using FlatRam = std::array<uint8_t, 0x1000>;
+
+// RAM split into reference-counted pages. Copies share pages, and a page is
+// copied on the first write through a copy that shares it, so a copy costs
+// the page table plus the pages it writes. Pages never written after copying,
+// like fonts and code, stay shared by all copies. Copies may be used from
+// different threads.
+class PagedRam {
+ public:
+  static constexpr std::size_t page_size{0x100};
+  static constexpr std::size_t page_count{0x1000 / page_size};
+
+  // All zero. Shares one page for all of it with every other PagedRam.
+  PagedRam();
+
+  explicit PagedRam(const FlatRam& ram);
+
+  explicit operator FlatRam() const;
+
+  static constexpr std::size_t size() { return page_size * page_count; }
+
+  const uint8_t& operator[](std::size_t address) const {
+    return pages_[address / page_size]->bytes[address % page_size];
+  }
+
+  const uint8_t& at(std::size_t address) const {
+    if (address >= size()) {
+      throw std::out_of_range("RAM address out of range.");
+    }
+    return (*this)[address];
+  }
+
+  // Byte for writing, copying its page first if it is shared.
+  uint8_t& writable(std::size_t address) {
+    auto& page{pages_[address / page_size]};
+    if (page.use_count() > 1) [[unlikely]] {
+      unshare(page);
+    } else {
+      // Sees all accesses of copies that released the page.
+      std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    return page->bytes[address % page_size];
+  }
+
+  // [address, address + length), which must be within RAM. Points into RAM if
+  // the range is within one page, into buffer otherwise.
+  std::span<const uint8_t> view(std::size_t address, std::size_t length, std::span<uint8_t> buffer) const;
+
+  // Write values from address on, which must fit in RAM.
+  void write(std::size_t address, std::span<const uint8_t> values);
+
+  // Bytes of pages not shared with another copy.
+  std::size_t unshared_bytes() const;
+
+  bool operator==(const PagedRam& other) const;
+  bool operator==(const FlatRam& other) const;
+
+ private:
+  struct Page {
+    std::array<uint8_t, page_size> bytes{};
+  };
+
+  std::array<std::shared_ptr<Page>, page_count> pages_;
+
+  // Replace page with a copy owned by this RAM only.
+  [[gnu::noinline]] static void unshare(std::shared_ptr<Page>& page);
+};
+
+// Same functions for FlatRam, so Chip8 can use either.
+inline std::span<const uint8_t> view(const FlatRam& ram, std::size_t address, std::size_t length,
+                                     std::span<uint8_t> /*buffer*/) {
+  return std::span<const uint8_t>{ram}.subspan(address, length);
+}
+
+inline std::span<const uint8_t> view(const PagedRam& ram, std::size_t address, std::size_t length,
+                                     std::span<uint8_t> buffer) {
+  return ram.view(address, length, buffer);
+}
+
+inline void write(FlatRam& ram, std::size_t address, std::span<const uint8_t> values) {
+  std::copy(values.begin(), values.end(), ram.begin() + static_cast<std::ptrdiff_t>(address));
+}
+
+inline void write(PagedRam& ram, std::size_t address, std::span<const uint8_t> values) { ram.write(address, values); }
+
+}  // namespace memory
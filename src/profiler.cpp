@@ -0,0 +1,170 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+
+namespace {
+
+// Opcode classes, indexed by opcode_class().
+const std::array<const char*, 38> opcode_names{
+    "unknown", "00E0", "00EE", "1NNN", "2NNN", "3XNN", "4XNN", "5XY0", "6XNN", "7XNN", "8XY0", "8XY1", "8XY2",
+    "8XY3",    "8XY4", "8XY5", "8XY6", "8XY7", "8XYE", "9XY0", "ANNN", "BNNN", "CXNN", "DXYN", "EX9E", "EXA1",
+    "FX07",    "FX0A", "FX15", "FX18", "FX1E", "FX29", "FX33", "FX55", "FX65", "0NNN", "F002", "FX3A",
+};
+
+std::size_t opcode_class(uint16_t opcode) {
+  const auto low_byte{opcode & 0x00FF};
+  switch (opcode & 0xF000) {
+    case 0x0000: {
+      if (low_byte == 0x00E0) {
+        return 1;
+      }
+      if (low_byte == 0x00EE) {
+        return 2;
+      }
+      return 35;
+    }
+    case 0x8000: {
+      const auto low_nibble{opcode & 0x000F};
+      if (low_nibble <= 0x7) {
+        return 10 + low_nibble;
+      }
+      return low_nibble == 0xE ? 18 : 0;
+    }
+    case 0xE000: {
+      if (low_byte == 0x9E) {
+        return 24;
+      }
+      return low_byte == 0xA1 ? 25 : 0;
+    }
+    case 0xF000: {
+      if (opcode == 0xF002) {
+        return 36;
+      }
+      if (low_byte == 0x3A) {
+        return 37;
+      }
+      const std::array<uint8_t, 9> codes{0x07, 0x0A, 0x15, 0x18, 0x1E, 0x29, 0x33, 0x55, 0x65};
+      auto it{std::find(codes.begin(), codes.end(), low_byte)};
+      return it == codes.end() ? 0 : 26 + (it - codes.begin());
+    }
+    default: {
+      // 1NNN..7XNN map to 3..9, 9XY0..DXYN to 19..23.
+      const auto high_nibble{(opcode & 0xF000) >> 12};
+      return high_nibble < 0x8 ? 2 + high_nibble : 10 + high_nibble;
+    }
+  }
+}
+
+std::string hex_address(uint16_t address) {
+  std::ostringstream out;
+  out << "0x" << std::uppercase << std::hex << std::setw(3) << std::setfill('0') << address;
+  return out.str();
+}
+
+}  // namespace
+
+GuestProfiler::GuestProfiler() : opcode_counts_(opcode_names.size(), 0), frames_{Frame{0x200, 0, 0, {}}} {}
+
+void GuestProfiler::on_instruction(uint16_t pc, uint16_t opcode) {
+  ++instructions_;
+  ++opcode_counts_[opcode_class(opcode)];
+  ++address_counts_.at(pc);
+  ++frames_[current_].cycles;
+}
+
+void GuestProfiler::on_call(uint16_t target) {
+  ++call_counts_.at(target);
+
+  auto& children{frames_[current_].children};
+  auto it{std::find_if(children.begin(), children.end(),
+                       [&](std::size_t child) { return frames_[child].address == target; })};
+  if (it != children.end()) {
+    current_ = *it;
+    return;
+  }
+
+  frames_.push_back(Frame{target, current_, 0, {}});
+  frames_[current_].children.push_back(frames_.size() - 1);
+  current_ = frames_.size() - 1;
+}
+
+void GuestProfiler::on_return() {
+  // Unbalanced returns stay at the root.
+  current_ = frames_[current_].parent;
+}
+
+uint64_t GuestProfiler::opcode_count(const std::string& name) const {
+  auto it{std::find(opcode_names.begin(), opcode_names.end(), name)};
+  if (it == opcode_names.end()) {
+    return 0;
+  }
+  return opcode_counts_.at(it - opcode_names.begin());
+}
+
+uint64_t GuestProfiler::inclusive_cycles(std::size_t frame) const {
+  auto cycles{frames_[frame].cycles};
+  for (auto child : frames_[frame].children) {
+    cycles += inclusive_cycles(child);
+  }
+  return cycles;
+}
+
+void GuestProfiler::write_json(std::ostream& out) const {
+  out << "{\n  \"instructions\": " << instructions_ << ",\n  \"opcodes\": {";
+  const char* separator{""};
+  for (std::size_t i = 0; i < opcode_names.size(); ++i) {
+    if (opcode_counts_[i] > 0) {
+      out << separator << "\n    \"" << opcode_names.at(i) << "\": " << opcode_counts_[i];
+      separator = ",";
+    }
+  }
+
+  out << "\n  },\n  \"addresses\": {";
+  separator = "";
+  for (std::size_t pc = 0; pc < address_counts_.size(); ++pc) {
+    if (address_counts_.at(pc) > 0) {
+      out << separator << "\n    \"" << hex_address(pc) << "\": " << address_counts_.at(pc);
+      separator = ",";
+    }
+  }
+
+  // Inclusive cycles of a subroutine, summed over every stack it was called from.
+  std::map<uint16_t, uint64_t> subroutine_cycles;
+  for (std::size_t frame = 1; frame < frames_.size(); ++frame) {
+    subroutine_cycles[frames_[frame].address] += inclusive_cycles(frame);
+  }
+
+  out << "\n  },\n  \"subroutines\": {";
+  separator = "";
+  for (const auto& [address, cycles] : subroutine_cycles) {
+    out << separator << "\n    \"" << hex_address(address) << "\": {\"calls\": " << call_counts_.at(address)
+        << ", \"cycles\": " << cycles << "}";
+    separator = ",";
+  }
+  out << "\n  }\n}\n";
+}
+
+void GuestProfiler::write_folded(std::ostream& out) const {
+  for (std::size_t frame = 0; frame < frames_.size(); ++frame) {
+    if (frames_[frame].cycles == 0) {
+      continue;
+    }
+
+    std::vector<uint16_t> stack;
+    for (auto f = frame; f != 0; f = frames_[f].parent) {
+      stack.push_back(frames_[f].address);
+    }
+    stack.push_back(frames_[0].address);
+
+    const char* separator{""};
+    for (auto it = stack.rbegin(); it != stack.rend(); ++it) {
+      out << separator << hex_address(*it);
+      separator = ";";
+    }
+    out << " " << frames_[frame].cycles << "\n";
+  }
+}
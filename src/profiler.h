@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Profiling policies, selected with the Profiler parameter of Chip8.
+
+// Profiling disabled. Hooks are never invoked.
+struct NullProfiler {
+  static constexpr bool enabled{false};
+
+  void on_instruction(uint16_t /*pc*/, uint16_t /*opcode*/) {}
+  void on_call(uint16_t /*target*/) {}
+  void on_return() {}
+};
+
+// Counts executed instructions per opcode class and per address, and cycles
+// spent under every CALL stack.
+class GuestProfiler {
+ public:
+  static constexpr bool enabled{true};
+
+  GuestProfiler();
+
+  void on_instruction(uint16_t pc, uint16_t opcode);
+  void on_call(uint16_t target);
+  void on_return();
+
+  uint64_t instructions() const { return instructions_; }
+
+  // Executions of given opcode class, e.g. "DXYN".
+  uint64_t opcode_count(const std::string& name) const;
+
+  uint64_t address_count(uint16_t pc) const { return address_counts_.at(pc); }
+
+  // Write counters, and calls and inclusive cycles per subroutine, as JSON.
+  void write_json(std::ostream& out) const;
+
+  // Write self cycles per CALL stack in folded format, for flamegraph tools.
+  void write_folded(std::ostream& out) const;
+
+ private:
+  // Node of the calling context tree.
+  struct Frame {
+    uint16_t address{};
+    std::size_t parent{};
+    uint64_t cycles{};
+    std::vector<std::size_t> children{};
+  };
+
+  uint64_t instructions_{};
+  std::vector<uint64_t> opcode_counts_;
+  std::array<uint64_t, 0x1000> address_counts_{};
+  std::array<uint64_t, 0x1000> call_counts_{};
+  std::vector<Frame> frames_;
+  std::size_t current_{};
+
+  uint64_t inclusive_cycles(std::size_t frame) const;
+};
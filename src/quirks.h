@@ -0,0 +1,43 @@
+#pragma once
+
+// Quirk profiles, selected with the Quirks parameter of Chip8. All values are
+// compile-time constants, so each profile compiles to its own straight-line code.
+namespace quirks {
+
+// Original COSMAC VIP interpreter.
+struct CosmacVip {
+  // 8xy1, 8xy2 and 8xy3 reset VF to 0.
+  static constexpr bool vf_reset{true};
+  // 8xy6 and 8xyE shift Vy into Vx, instead of shifting Vx in place.
+  static constexpr bool shift_uses_vy{true};
+  // Fx55 and Fx65 leave I pointing past the last register.
+  static constexpr bool memory_increments_i{true};
+  // Bnnn jumps to nnn + V0, instead of Bxnn jumping to xnn + Vx.
+  static constexpr bool jump_uses_v0{true};
+  // Sprites wrap around screen edges, instead of being clipped.
+  static constexpr bool wrap_sprites{false};
+  // F002 loads the audio pattern and Fx3A sets the pitch, instead of being unknown opcodes.
+  static constexpr bool audio_pattern{false};
+};
+
+// SUPER-CHIP 1.1.
+struct SuperChip {
+  static constexpr bool vf_reset{false};
+  static constexpr bool shift_uses_vy{false};
+  static constexpr bool memory_increments_i{false};
+  static constexpr bool jump_uses_v0{false};
+  static constexpr bool wrap_sprites{false};
+  static constexpr bool audio_pattern{false};
+};
+
+// XO-CHIP.
+struct XoChip {
+  static constexpr bool vf_reset{false};
+  static constexpr bool shift_uses_vy{true};
+  static constexpr bool memory_increments_i{true};
+  static constexpr bool jump_uses_v0{true};
+  static constexpr bool wrap_sprites{true};
+  static constexpr bool audio_pattern{true};
+};
+
+}  // namespace quirks
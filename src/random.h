@@ -1,12 +1,47 @@
 #pragma once
 
-#include <random>
-
-// Simple random number generator.
-template <typename T>
-T random(T range_from, T range_to) {
-  std::random_device rand_dev;
-  std::mt19937 generator(rand_dev());
-  std::uniform_int_distribution<T> distr(range_from, range_to);
-  return distr(generator);
-}
\ No newline at end of file
+#include <cstdint>
+#include <limits>
+
+// PCG32 (XSH RR) random number generator. 8 bytes of state, cheap to seed
+// and copy, so every machine can own one and runs are reproducible.
+// Satisfies UniformRandomBitGenerator.
+class Pcg32 {
+ public:
+  using result_type = uint32_t;
+
+  static constexpr uint64_t default_seed{0x853C49E6748FEA9B};
+
+  explicit Pcg32(uint64_t seed = default_seed) { this->seed(seed); }
+
+  // Restart sequence from given seed.
+  void seed(uint64_t seed) {
+    state_ = 0;
+    (*this)();
+    state_ += seed;
+    (*this)();
+  }
+
+  result_type operator()() {
+    auto old{state_};
+    state_ = old * multiplier + increment;
+    auto xorshifted{static_cast<uint32_t>(((old >> 18U) ^ old) >> 27U)};
+    auto rot{static_cast<uint32_t>(old >> 59U)};
+    return (xorshifted >> rot) | (xorshifted << ((32U - rot) & 31U));
+  }
+
+  // Raw generator state, for storing a machine outside this process.
+  uint64_t state() const { return state_; }
+  void set_state(uint64_t state) { state_ = state; }
+
+  static constexpr result_type min() { return std::numeric_limits<result_type>::min(); }
+  static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+  bool operator==(const Pcg32&) const = default;
+
+ private:
+  static constexpr uint64_t multiplier{6364136223846793005ULL};
+  static constexpr uint64_t increment{1442695040888963407ULL};
+
+  uint64_t state_{};
+};
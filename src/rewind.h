@@ -0,0 +1,241 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+// Memory used by a Rewind buffer and the cost of recording into it.
+struct RewindStats {
+  std::size_t frames{0};
+  std::size_t keyframes{0};
+  // Encoded bytes held.
+  std::size_t bytes{0};
+  // Time spent encoding the last pushed frame.
+  std::chrono::nanoseconds last_encode{0};
+  // Mean time spent encoding a frame since construction.
+  std::chrono::nanoseconds mean_encode{0};
+};
+
+// History of per-frame snapshots in bounded memory. Every frame is stored as
+// its XOR against the previous one, run-length encoded, so frames where
+// little changed take a few bytes. Every keyframe_interval frames the full
+// snapshot is stored instead, bounding the cost of rebuilding a frame. Oldest
+// frames are dropped, a keyframe with its deltas at a time, when more than
+// max_frames or max_bytes are held.
+//
+// Encoding is a sequence of runs: 16-bit count of bytes unchanged, 16-bit
+// count of changed bytes, then the changed bytes XOR'ed with the previous frame.
+template <typename Snapshot>
+class Rewind {
+  static_assert(std::is_trivially_copyable_v<Snapshot>);
+  static_assert(sizeof(Snapshot) <= 0xFFFF, "run lengths are 16-bit");
+
+ public:
+  Rewind(std::size_t max_frames, std::size_t max_bytes, std::size_t keyframe_interval = 60)
+      : max_frames_{max_frames}, max_bytes_{max_bytes}, keyframe_interval_{keyframe_interval} {}
+
+  // Record a frame.
+  void push(const Snapshot& snapshot) {
+    auto start{std::chrono::steady_clock::now()};
+
+    Frame frame{};
+    frame.keyframe = frames_.empty() || since_keyframe_ + 1 >= keyframe_interval_;
+    if (frame.keyframe) {
+      encode(bytes_of(snapshot), {}, frame.data);
+      since_keyframe_ = 0;
+    } else {
+      encode(bytes_of(snapshot), bytes_of(newest_), frame.data);
+      ++since_keyframe_;
+    }
+    bytes_ += frame.data.size();
+    keyframes_ += frame.keyframe ? 1 : 0;
+    frames_.push_back(std::move(frame));
+    newest_ = snapshot;
+    drop_oldest();
+
+    last_encode_ = std::chrono::steady_clock::now() - start;
+    total_encode_ += last_encode_;
+    ++pushed_;
+  }
+
+  // Drop the newest frame and write the one before it to snapshot. Returns
+  // false, leaving snapshot untouched, if there is no older frame.
+  bool step_back(Snapshot& snapshot) {
+    if (frames_.size() < 2) {
+      return false;
+    }
+
+    auto& frame{frames_.back()};
+    bool keyframe{frame.keyframe};
+    if (!keyframe) {
+      decode(frame.data, writable_bytes_of(newest_));
+    }
+    bytes_ -= frame.data.size();
+    keyframes_ -= keyframe ? 1 : 0;
+    frames_.pop_back();
+
+    if (keyframe) {
+      // Rebuild from the previous keyframe.
+      since_keyframe_ = rebuild(newest_);
+    } else {
+      --since_keyframe_;
+    }
+    snapshot = newest_;
+    return true;
+  }
+
+  // Drop all frames.
+  void clear() {
+    frames_.clear();
+    bytes_ = 0;
+    keyframes_ = 0;
+    since_keyframe_ = 0;
+  }
+
+  std::size_t frames() const { return frames_.size(); }
+
+  RewindStats stats() const {
+    RewindStats stats{frames_.size(), keyframes_, bytes_, last_encode_, {}};
+    if (pushed_ > 0) {
+      stats.mean_encode = total_encode_ / pushed_;
+    }
+    return stats;
+  }
+
+ private:
+  struct Frame {
+    bool keyframe;
+    std::vector<uint8_t> data;
+  };
+
+  // Runs shorter than this are kept inside a changed run, a new run costs 4 bytes.
+  static constexpr std::size_t min_unchanged_run{4};
+
+  std::size_t max_frames_;
+  std::size_t max_bytes_;
+  std::size_t keyframe_interval_;
+  std::deque<Frame> frames_{};
+  std::size_t bytes_{0};
+  std::size_t keyframes_{0};
+  // Frames pushed after the newest keyframe.
+  std::size_t since_keyframe_{0};
+  // Newest frame, decoded.
+  Snapshot newest_{};
+
+  std::chrono::nanoseconds last_encode_{0};
+  std::chrono::nanoseconds total_encode_{0};
+  std::size_t pushed_{0};
+
+  static std::span<const uint8_t> bytes_of(const Snapshot& snapshot) {
+    // Ignoring due to no other way of doing it.
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    return {reinterpret_cast<const uint8_t*>(&snapshot), sizeof(Snapshot)};
+  }
+
+  static std::span<uint8_t> writable_bytes_of(Snapshot& snapshot) {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    return {reinterpret_cast<uint8_t*>(&snapshot), sizeof(Snapshot)};
+  }
+
+  static void put_u16(std::vector<uint8_t>& out, std::size_t value) {
+    out.push_back(static_cast<uint8_t>(value & 0xFF));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+  }
+
+  static std::size_t get_u16(std::span<const uint8_t> in, std::size_t pos) {
+    return static_cast<std::size_t>(in[pos] | in[pos + 1] << 8);
+  }
+
+  // Encode current XOR previous, or current alone if previous is empty.
+  static void encode(std::span<const uint8_t> current, std::span<const uint8_t> previous,
+                     std::vector<uint8_t>& out) {
+    auto diff{[&](std::size_t i) -> uint8_t { return previous.empty() ? current[i] : current[i] ^ previous[i]; }};
+    const auto size{current.size()};
+
+    std::size_t pos{0};
+    while (pos < size) {
+      auto changed{pos};
+      while (changed < size && diff(changed) == 0) {
+        ++changed;
+      }
+
+      // Extend changed run until min_unchanged_run unchanged bytes or the end.
+      auto end{changed};
+      while (end < size) {
+        if (diff(end) != 0) {
+          ++end;
+          continue;
+        }
+        auto zeros{end};
+        while (zeros < size && diff(zeros) == 0) {
+          ++zeros;
+        }
+        if (zeros == size || zeros - end >= min_unchanged_run) {
+          break;
+        }
+        end = zeros;
+      }
+
+      put_u16(out, changed - pos);
+      put_u16(out, end - changed);
+      for (auto i = changed; i < end; ++i) {
+        out.push_back(diff(i));
+      }
+      pos = end;
+    }
+  }
+
+  // XOR encoded changes into target.
+  static void decode(std::span<const uint8_t> data, std::span<uint8_t> target) {
+    std::size_t in{0};
+    std::size_t out{0};
+    while (in < data.size()) {
+      out += get_u16(data, in);
+      auto changed{get_u16(data, in + 2)};
+      in += 4;
+      for (std::size_t i = 0; i < changed; ++i) {
+        target[out++] ^= data[in++];
+      }
+    }
+  }
+
+  // Decode the newest frame into snapshot, starting from the newest keyframe.
+  // Returns number of frames after that keyframe.
+  std::size_t rebuild(Snapshot& snapshot) const {
+    auto keyframe{frames_.size() - 1};
+    while (!frames_[keyframe].keyframe) {
+      --keyframe;
+    }
+
+    auto target{writable_bytes_of(snapshot)};
+    std::fill(target.begin(), target.end(), 0);
+    for (auto i = keyframe; i < frames_.size(); ++i) {
+      decode(frames_[i].data, target);
+    }
+    return frames_.size() - 1 - keyframe;
+  }
+
+  // Drop oldest keyframe with its deltas while over limits, always keeping
+  // the newest keyframe.
+  void drop_oldest() {
+    while (frames_.size() > max_frames_ || bytes_ > max_bytes_) {
+      auto next_keyframe{std::size_t{1}};
+      while (next_keyframe < frames_.size() && !frames_[next_keyframe].keyframe) {
+        ++next_keyframe;
+      }
+      if (next_keyframe == frames_.size()) {
+        return;
+      }
+      for (std::size_t i = 0; i < next_keyframe; ++i) {
+        bytes_ -= frames_.front().data.size();
+        keyframes_ -= frames_.front().keyframe ? 1 : 0;
+        frames_.pop_front();
+      }
+    }
+  }
+};
@@ -0,0 +1,190 @@
+#include "rom_archive.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <map>
+#include <stdexcept>
+
+namespace {
+
+constexpr std::array<uint8_t, 4> magic{'C', '8', 'R', 'A'};
+constexpr uint32_t version{1};
+constexpr std::size_t header_size{16};
+constexpr std::size_t entry_size{16};
+
+void write_le(std::ostream& out, uint64_t value, std::size_t size) {
+  for (std::size_t i = 0; i < size; ++i) {
+    out.put(static_cast<char>((value >> (8 * i)) & 0xFF));
+  }
+}
+
+uint64_t read_le(std::span<const uint8_t> data, std::size_t offset, std::size_t size) {
+  uint64_t value{0};
+  for (std::size_t i = 0; i < size; ++i) {
+    value |= static_cast<uint64_t>(data[offset + i]) << (8 * i);
+  }
+  return value;
+}
+
+}  // namespace
+
+uint64_t fnv1a(std::span<const uint8_t> data) {
+  uint64_t hash{0xCBF29CE484222325};
+  for (auto byte : data) {
+    hash ^= byte;
+    hash *= 0x100000001B3;
+  }
+  return hash;
+}
+
+std::vector<uint32_t> rom_offsets(std::span<const std::size_t> sizes) {
+  std::vector<uint32_t> offsets;
+  offsets.reserve(sizes.size());
+  uint64_t offset{header_size + sizes.size() * entry_size};
+  for (auto size : sizes) {
+    offsets.push_back(static_cast<uint32_t>(offset));
+    offset += size;
+    if (offset > UINT32_MAX) {
+      throw std::runtime_error("ROM archive too large.");
+    }
+  }
+  return offsets;
+}
+
+namespace {
+
+// ROMs ordered by hash, as in the index, duplicates dropped.
+using RomIndex = std::map<uint64_t, const std::vector<uint8_t>*>;
+
+RomIndex index_roms(const std::vector<std::vector<uint8_t>>& roms) {
+  RomIndex index;
+  for (const auto& rom : roms) {
+    index.emplace(fnv1a(rom), &rom);
+  }
+  return index;
+}
+
+std::vector<uint32_t> index_offsets(const RomIndex& index) {
+  std::vector<std::size_t> sizes;
+  for (const auto& [hash, rom] : index) {
+    sizes.push_back(rom->size());
+  }
+  return rom_offsets(sizes);
+}
+
+}  // namespace
+
+std::vector<uint32_t> rom_archive_offsets(const std::vector<std::vector<uint8_t>>& roms) {
+  return index_offsets(index_roms(roms));
+}
+
+uint64_t parse_rom_hash(const std::string& text) {
+  if (text.empty() || text.size() > 16 || text.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos) {
+    throw std::invalid_argument("Invalid ROM hash \"" + text + "\", expected up to 16 hex digits.");
+  }
+  return std::stoull(text, nullptr, 16);
+}
+
+void write_rom_archive(std::ostream& out, const std::vector<std::vector<uint8_t>>& roms) {
+  auto index{index_roms(roms)};
+  // Laid out in full first, so nothing is written if it doesn't fit.
+  auto offsets{index_offsets(index)};
+
+  // Ignoring due to no other way of doing it.
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  out.write(reinterpret_cast<const char*>(magic.data()), magic.size());
+  write_le(out, version, 4);
+  write_le(out, index.size(), 4);
+  write_le(out, 0, 4);
+
+  auto offset{offsets.begin()};
+  for (const auto& [hash, rom] : index) {
+    write_le(out, hash, 8);
+    write_le(out, *offset++, 4);
+    write_le(out, rom->size(), 4);
+  }
+
+  for (const auto& [hash, rom] : index) {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    out.write(reinterpret_cast<const char*>(rom->data()), static_cast<std::streamsize>(rom->size()));
+  }
+}
+
+RomArchive::RomArchive(const std::string& path) {
+  auto fd{open(path.c_str(), O_RDONLY)};
+  if (fd < 0) {
+    throw std::runtime_error("Can't open ROM archive.");
+  }
+  struct stat st {};
+  if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(header_size)) {
+    close(fd);
+    throw std::runtime_error("Not a ROM archive.");
+  }
+  auto size{static_cast<std::size_t>(st.st_size)};
+  auto* mapping{mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0)};
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    throw std::runtime_error("Can't map ROM archive.");
+  }
+  data_ = {static_cast<const uint8_t*>(mapping), size};
+
+  // Validated once, lookups don't check bounds.
+  auto valid{[&]() {
+    if (!std::equal(magic.begin(), magic.end(), data_.begin()) || read_le(data_, 4, 4) != version) {
+      return false;
+    }
+    count_ = read_le(data_, 8, 4);
+    if (header_size + count_ * entry_size > size) {
+      return false;
+    }
+    for (std::size_t i = 0; i < count_; ++i) {
+      auto entry{header_size + i * entry_size};
+      if (read_le(data_, entry + 8, 4) + read_le(data_, entry + 12, 4) > size) {
+        return false;
+      }
+      if (i > 0 && hash(i - 1) >= hash(i)) {
+        return false;
+      }
+    }
+    return true;
+  }};
+  if (!valid()) {
+    munmap(mapping, size);
+    throw std::runtime_error("Not a ROM archive.");
+  }
+}
+
+RomArchive::~RomArchive() {
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+  munmap(const_cast<uint8_t*>(data_.data()), data_.size());
+}
+
+uint64_t RomArchive::hash(std::size_t index) const { return read_le(data_, header_size + index * entry_size, 8); }
+
+std::span<const uint8_t> RomArchive::rom(std::size_t index) const {
+  auto entry{header_size + index * entry_size};
+  return data_.subspan(read_le(data_, entry + 8, 4), read_le(data_, entry + 12, 4));
+}
+
+std::optional<std::span<const uint8_t>> RomArchive::find(uint64_t hash) const {
+  std::size_t first{0};
+  std::size_t last{count_};
+  while (first < last) {
+    auto middle{first + (last - first) / 2};
+    auto middle_hash{this->hash(middle)};
+    if (middle_hash == hash) {
+      return rom(middle);
+    }
+    if (middle_hash < hash) {
+      first = middle + 1;
+    } else {
+      last = middle;
+    }
+  }
+  return std::nullopt;
+}
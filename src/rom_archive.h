@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string>
+#include <vector>
+
+// 64-bit FNV-1a hash of data. ROMs in an archive are looked up by it.
+uint64_t fnv1a(std::span<const uint8_t> data);
+
+// Offset of each ROM from the start of an archive holding ROMs of given
+// sizes, in the same order. Throws std::runtime_error if the archive would
+// not fit the 32-bit offsets.
+std::vector<uint32_t> rom_offsets(std::span<const std::size_t> sizes);
+
+// Offset of each ROM in the archive write_rom_archive() writes for given ROMs,
+// in the order of its index. Throws std::runtime_error if it is too large, so
+// a tool can check before it opens the output.
+std::vector<uint32_t> rom_archive_offsets(const std::vector<std::vector<uint8_t>>& roms);
+
+// Hash of a ROM as printed by chip8-pack, 1 to 16 hex digits. Throws
+// std::invalid_argument if text is not one.
+uint64_t parse_rom_hash(const std::string& text);
+
+// Write archive holding given ROMs. Duplicates are stored once. Throws
+// std::runtime_error before writing anything if the archive is too large.
+//
+// Layout, all fields little-endian: "C8RA" magic, 32-bit version, 32-bit ROM
+// count and 4 reserved bytes. Then the index, one 16-byte entry per ROM
+// ordered by hash: 64-bit FNV-1a hash, 32-bit offset of the ROM from the
+// start of the file and 32-bit size. ROM data follows the index.
+void write_rom_archive(std::ostream& out, const std::vector<std::vector<uint8_t>>& roms);
+
+// Read-only view of a ROM archive, memory-mapped for its lifetime. Finding a
+// ROM is a binary search of the index, and ROMs are returned in place.
+class RomArchive {
+ public:
+  // Map archive. Throws std::runtime_error if the file can't be mapped or is
+  // not a valid archive.
+  explicit RomArchive(const std::string& path);
+  ~RomArchive();
+
+  RomArchive(const RomArchive&) = delete;
+  RomArchive& operator=(const RomArchive&) = delete;
+
+  // Number of ROMs.
+  std::size_t size() const { return count_; }
+
+  // Hash of ROM at given index position.
+  uint64_t hash(std::size_t index) const;
+
+  // ROM at given index position.
+  std::span<const uint8_t> rom(std::size_t index) const;
+
+  // ROM with given hash, if any.
+  std::optional<std::span<const uint8_t>> find(uint64_t hash) const;
+
+ private:
+  std::span<const uint8_t> data_{};
+  std::size_t count_{0};
+};
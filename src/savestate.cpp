@@ -0,0 +1,63 @@
+#include "savestate.h"
+
+#include <stdexcept>
+
+namespace savestate {
+
+namespace {
+
+void write_u32(std::ostream& out, uint32_t value) {
+  std::array<char, 4> bytes{};
+  for (std::size_t i = 0; i < bytes.size(); ++i) {
+    bytes.at(i) = static_cast<char>((value >> (8 * i)) & 0xFF);
+  }
+  out.write(bytes.data(), bytes.size());
+}
+
+uint32_t read_u32(std::istream& in) {
+  std::array<char, 4> bytes{};
+  in.read(bytes.data(), bytes.size());
+  uint32_t value{0};
+  for (std::size_t i = 0; i < bytes.size(); ++i) {
+    value |= static_cast<uint32_t>(static_cast<uint8_t>(bytes.at(i))) << (8 * i);
+  }
+  return value;
+}
+
+}  // namespace
+
+void write(std::ostream& out, std::span<const uint8_t> body) {
+  out.write(magic.data(), magic.size());
+  write_u32(out, version);
+  write_u32(out, static_cast<uint32_t>(body.size()));
+  // Ignoring due to no other way of doing it.
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  out.write(reinterpret_cast<const char*>(body.data()), static_cast<std::streamsize>(body.size()));
+}
+
+void read(std::istream& in, std::span<uint8_t> body) {
+  std::array<char, 4> file_magic{};
+  in.read(file_magic.data(), file_magic.size());
+  auto file_version{read_u32(in)};
+  auto file_size{read_u32(in)};
+  if (!in) {
+    throw std::runtime_error("Truncated save state.");
+  }
+  if (file_magic != magic) {
+    throw std::runtime_error("Not a save state.");
+  }
+  if (file_version != version) {
+    throw std::runtime_error("Unsupported save state version.");
+  }
+  if (file_size != body.size()) {
+    throw std::runtime_error("Save state size mismatch.");
+  }
+
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  in.read(reinterpret_cast<char*>(body.data()), static_cast<std::streamsize>(body.size()));
+  if (!in) {
+    throw std::runtime_error("Truncated save state.");
+  }
+}
+
+}  // namespace savestate
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <span>
+#include <vector>
+
+// On-disk save states: a header followed by the fields of a Chip8::Snapshot,
+// each stored explicitly, so files move between hosts. All integers are
+// little-endian.
+namespace savestate {
+
+// "C8SS".
+constexpr std::array<char, 4> magic{'C', '8', 'S', 'S'};
+// Bumped whenever layout of the snapshot changes.
+constexpr uint32_t version{4};
+
+// Write header and encoded snapshot to stream.
+void write(std::ostream& out, std::span<const uint8_t> body);
+
+// Read encoded snapshot from stream. Throws std::runtime_error if the stream
+// is truncated, or if it is not a save state of this version and size.
+void read(std::istream& in, std::span<uint8_t> body);
+
+// Appends fields in little-endian order.
+class Encoder {
+ public:
+  template <std::unsigned_integral T>
+  void put(T value) {
+    for (std::size_t i = 0; i < sizeof(T); ++i) {
+      bytes_.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+  }
+
+  template <std::unsigned_integral T, std::size_t N>
+  void put(const std::array<T, N>& values) {
+    for (auto value : values) {
+      put(value);
+    }
+  }
+
+  const std::vector<uint8_t>& bytes() const { return bytes_; }
+
+ private:
+  std::vector<uint8_t> bytes_;
+};
+
+// Reads fields written by Encoder, in the same order.
+class Decoder {
+ public:
+  explicit Decoder(std::span<const uint8_t> bytes) : bytes_{bytes} {}
+
+  template <std::unsigned_integral T>
+  T get() {
+    T value{0};
+    for (std::size_t i = 0; i < sizeof(T); ++i) {
+      value |= static_cast<T>(static_cast<T>(bytes_[position_++]) << (8 * i));
+    }
+    return value;
+  }
+
+  template <std::unsigned_integral T, std::size_t N>
+  void get(std::array<T, N>& values) {
+    for (auto& value : values) {
+      value = get<T>();
+    }
+  }
+
+ private:
+  std::span<const uint8_t> bytes_;
+  std::size_t position_{0};
+};
+
+template <typename Snapshot>
+void encode(Encoder& encoder, const Snapshot& snapshot) {
+  const auto& machine{snapshot.machine};
+  encoder.put(machine.ram);
+  encoder.put(machine.registers);
+  encoder.put(machine.dt);
+  encoder.put(machine.st);
+  encoder.put(machine.ir);
+  encoder.put(machine.pc);
+  encoder.put(machine.sp);
+  encoder.put(machine.stack);
+  encoder.put(machine.rng.state());
+  encoder.put(machine.cycles);
+  encoder.put(machine.audio_pattern);
+  encoder.put(machine.pitch);
+  encoder.put(snapshot.framebuffer);
+}
+
+template <typename Snapshot>
+void decode(Decoder& decoder, Snapshot& snapshot) {
+  auto& machine{snapshot.machine};
+  decoder.get(machine.ram);
+  decoder.get(machine.registers);
+  machine.dt = decoder.get<uint8_t>();
+  machine.st = decoder.get<uint8_t>();
+  machine.ir = decoder.get<uint16_t>();
+  machine.pc = decoder.get<uint16_t>();
+  machine.sp = decoder.get<uint8_t>();
+  decoder.get(machine.stack);
+  machine.rng.set_state(decoder.get<uint64_t>());
+  machine.cycles = decoder.get<uint64_t>();
+  decoder.get(machine.audio_pattern);
+  machine.pitch = decoder.get<uint8_t>();
+  decoder.get(snapshot.framebuffer);
+}
+
+template <typename Snapshot>
+void save(std::ostream& out, const Snapshot& snapshot) {
+  Encoder encoder;
+  encode(encoder, snapshot);
+  write(out, encoder.bytes());
+}
+
+template <typename Snapshot>
+void load(std::istream& in, Snapshot& snapshot) {
+  // Every field has a fixed width, so any snapshot encodes to the same size.
+  Encoder sizing;
+  encode(sizing, Snapshot{});
+  std::vector<uint8_t> body(sizing.bytes().size());
+  read(in, body);
+  Decoder decoder{body};
+  decode(decoder, snapshot);
+}
+
+}  // namespace savestate
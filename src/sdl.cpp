@@ -2,91 +2,63 @@
 
 #include <SDL2/SDL.h>
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <stdexcept>
 #include <string>
-#include <vector>
 
-std::array<bool, 16> EmptyInput::key_state() { return state_; }
-
-void EmptyInput::set_key_state(int key, bool state) { state_.at(key) = state; }
+void EmptyInput::set_key_state(int key, bool state) {
+  if (key < 0 || key > 0xF) {
+    throw std::out_of_range("Invalid key.");
+  }
+  auto mask{static_cast<uint16_t>(1U << key)};
+  keys_ = state ? keys_ | mask : keys_ & ~mask;
+}
 
-std::array<bool, 16> SdlInput::key_state() {
+void SdlInput::poll(int timeout_ms) {
   SDL_Event e;
-  while (SDL_PollEvent(&e) != 0) {
-    if (e.type == SDL_QUIT) {
-      emulator_active_ = false;
-      cv_.notify_all();
+  if (SDL_WaitEventTimeout(&e, timeout_ms) != 0) {
+    do {
+      if (e.type == SDL_QUIT) {
+        emulator_active_ = false;
+      } else if (e.type == SDL_WINDOWEVENT &&
+                 (e.window.event == SDL_WINDOWEVENT_EXPOSED || e.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)) {
+        redraw_ = true;
+      }
+    } while (SDL_PollEvent(&e) != 0);
+  }
+
+  // Scancode of every key.
+  static const std::array<SDL_Scancode, 16> keymap{
+      SDL_SCANCODE_X, SDL_SCANCODE_1, SDL_SCANCODE_2, SDL_SCANCODE_3, SDL_SCANCODE_Q, SDL_SCANCODE_W,
+      SDL_SCANCODE_E, SDL_SCANCODE_A, SDL_SCANCODE_S, SDL_SCANCODE_D, SDL_SCANCODE_Z, SDL_SCANCODE_C,
+      SDL_SCANCODE_4, SDL_SCANCODE_R, SDL_SCANCODE_F, SDL_SCANCODE_V,
+  };
+
+  const Uint8* state{SDL_GetKeyboardState(nullptr)};
+  uint16_t keys{0};
+  for (std::size_t key = 0; key < keymap.size(); ++key) {
+    // Ignoring due to SDL interface.
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    if (state[keymap.at(key)] != 0) {
+      keys |= static_cast<uint16_t>(1U << key);
     }
   }
-
-  SDL_PumpEvents();
-
-  int len_state{0};
-  const Uint8* state_raw = SDL_GetKeyboardState(&len_state);
-  // Ignoring due to SDL interface.
+  keys_.store(keys, std::memory_order_relaxed);
   // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-  std::vector<uint8_t> state{state_raw, state_raw + len_state};
-
-  std::array<bool, 16> key_state{};
-
-  if (state.at(SDL_SCANCODE_1)) {
-    key_state[0x1] = true;
-  }
-  if (state.at(SDL_SCANCODE_2)) {
-    key_state[0x2] = true;
-  }
-  if (state.at(SDL_SCANCODE_3)) {
-    key_state[0x3] = true;
-  }
-  if (state.at(SDL_SCANCODE_4)) {
-    key_state[0xC] = true;
-  }
-
-  if (state.at(SDL_SCANCODE_Q)) {
-    key_state[0x4] = true;
-  }
-  if (state.at(SDL_SCANCODE_W)) {
-    key_state[0x5] = true;
-  }
-  if (state.at(SDL_SCANCODE_E)) {
-    key_state[0x6] = true;
-  }
-  if (state.at(SDL_SCANCODE_R)) {
-    key_state[0xD] = true;
-  }
-
-  if (state.at(SDL_SCANCODE_A)) {
-    key_state[0x7] = true;
-  }
-  if (state.at(SDL_SCANCODE_S)) {
-    key_state[0x8] = true;
-  }
-  if (state.at(SDL_SCANCODE_D)) {
-    key_state[0x9] = true;
-  }
-  if (state.at(SDL_SCANCODE_F)) {
-    key_state[0xE] = true;
-  }
-
-  if (state.at(SDL_SCANCODE_Z)) {
-    key_state[0xA] = true;
-  }
-  if (state.at(SDL_SCANCODE_X)) {
-    key_state[0x0] = true;
-  }
-  if (state.at(SDL_SCANCODE_C)) {
-    key_state[0xB] = true;
-  }
-  if (state.at(SDL_SCANCODE_V)) {
-    key_state[0xF] = true;
-  }
-
-  return key_state;
+  rewind_held_ = state[SDL_SCANCODE_BACKSPACE] != 0;
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  fast_forward_held_ = state[SDL_SCANCODE_TAB] != 0;
 }
 
 bool SdlInput::emulator_active() const { return emulator_active_; }
 
-std::condition_variable& SdlInput::emulator_active_cv() { return cv_; }
+bool SdlInput::rewind_held() const { return rewind_held_; }
+
+bool SdlInput::fast_forward_held() const { return fast_forward_held_; }
+
+bool SdlInput::take_redraw() { return redraw_.exchange(false); }
 
 SdlGfx::SdlGfx(int window_width, int window_height)
     : Gfx{},
@@ -109,15 +81,19 @@ SdlGfx::~SdlGfx() {
   SDL_QuitSubSystem(SDL_INIT_VIDEO);
 }
 
-// Render to screen.
-void SdlGfx::render() {
+void SdlGfx::set_title(const std::string& title) { SDL_SetWindowTitle(window_, title.c_str()); }
+
+// Render rows [first_row, last_row] to screen.
+void SdlGfx::render(int first_row, int last_row) {
+  // Replaced by SDL when the window is resized.
+  surface_ = SDL_GetWindowSurface(window_);
   int block_width{width_ / chip8_width};
   int block_height{height_ / chip8_height};
-  for (int y = 0; y < chip8_height; ++y) {
+  for (int y = first_row; y <= last_row; ++y) {
     for (int x = 0; x < chip8_width; ++x) {
       SDL_Rect block{x * block_width, y * block_height, block_width, block_height};
 
-      auto color_v{map_.at(y * chip8_width + x) ? 0xFF : 0};
+      auto color_v{(rows_[y] & pixel_mask(x)) != 0 ? 0xFF : 0};
       Uint8 color{static_cast<Uint8>(color_v)};
       Uint32 color_sdl{SDL_MapRGB(surface_->format, color, color, color)};
 
@@ -125,31 +101,76 @@ void SdlGfx::render() {
     }
   }
 
-  SDL_UpdateWindowSurface(window_);
+  SDL_Rect changed{0, first_row * block_height, chip8_width * block_width, (last_row - first_row + 1) * block_height};
+  SDL_UpdateWindowSurfaceRects(window_, &changed, 1);
+}
+
+SdlTextureGfx::SdlTextureGfx(int window_width, int window_height) : Gfx{} {
+  SDL_Init(SDL_INIT_VIDEO);
+  std::string title{"Chip8"};
+  window_ = SDL_CreateWindow(title.c_str(), SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, window_width,
+                             window_height, SDL_WINDOW_SHOWN);
+  // Ignoring due to SDL interface.
+  // NOLINTBEGIN(cppcoreguidelines-prefer-member-initializer)
+  renderer_ = SDL_CreateRenderer(window_, -1, SDL_RENDERER_SOFTWARE);
+  texture_ = SDL_CreateTexture(renderer_, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, chip8_width,
+                               chip8_height);
+  // NOLINTEND(cppcoreguidelines-prefer-member-initializer)
+
+  // Texture format is fixed, so colors are mapped only once.
+  color_on_ = 0xFFFFFFFF;
+  color_off_ = 0xFF000000;
+}
+
+SdlTextureGfx::~SdlTextureGfx() {
+  SDL_DestroyTexture(texture_);
+  SDL_DestroyRenderer(renderer_);
+  SDL_DestroyWindow(window_);
+  SDL_QuitSubSystem(SDL_INIT_VIDEO);
+}
+
+void SdlTextureGfx::set_title(const std::string& title) { SDL_SetWindowTitle(window_, title.c_str()); }
+
+// Render rows [first_row, last_row] to screen.
+void SdlTextureGfx::render(int first_row, int last_row) {
+  SDL_Rect changed{0, first_row, chip8_width, last_row - first_row + 1};
+  void* pixels{nullptr};
+  int pitch{0};
+  if (SDL_LockTexture(texture_, &changed, &pixels, &pitch) != 0) {
+    return;
+  }
+
+  for (int y = first_row; y <= last_row; ++y) {
+    // Ignoring due to SDL interface.
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    auto* row{reinterpret_cast<Uint32*>(static_cast<Uint8*>(pixels) + (y - first_row) * pitch)};
+    auto bits{rows_[y]};
+    for (int x = 0; x < chip8_width; ++x) {
+      // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+      row[x] = (bits & pixel_mask(x)) != 0 ? color_on_ : color_off_;
+    }
+  }
+  SDL_UnlockTexture(texture_);
+
+  // Texture is scaled to the whole window.
+  SDL_RenderCopy(renderer_, texture_, nullptr, nullptr);
+  SDL_RenderPresent(renderer_);
 }
 
-SdlAudio::SdlAudio() {
+SdlAudio::SdlAudio(int buffer_samples) {
   SDL_Init(SDL_INIT_AUDIO);
 
   spec_.freq = 44100;
   spec_.format = AUDIO_S16SYS;
   spec_.channels = 1;
-  spec_.samples = 1024;
-  spec_.callback = nullptr;
+  spec_.samples = static_cast<Uint16>(buffer_samples);
+  spec_.callback = &SdlAudio::callback;
+  spec_.userdata = this;
 
+  set_pattern(default_audio_pattern);
   device_ = SDL_OpenAudioDevice(nullptr, 0, &spec_, nullptr, 0);
-
-  // Prepare 1 second sample.
-  sample_ = std::make_unique<int16_t[]>(spec_.freq);
-  float x = 0.0f;
-  for (int i = 0; i < spec_.freq; ++i) {
-    x += .01f;
-    sample_[i] = sin(x * 4) * 5000;
-  }
-
-  // Load sample to device.
-  const auto sample_size{spec_.freq * sizeof(int16_t)};
-  SDL_QueueAudio(device_, sample_.get(), sample_size);
+  // Callback generates silence until play().
+  SDL_PauseAudioDevice(device_, 0);
 }
 
 SdlAudio::~SdlAudio() {
@@ -157,6 +178,76 @@ SdlAudio::~SdlAudio() {
   SDL_QuitSubSystem(SDL_INIT_AUDIO);
 }
 
-void SdlAudio::play() { SDL_PauseAudioDevice(device_, 0); }
+void SdlAudio::play() {
+  if (!playing_.exchange(true)) {
+    auto now{std::chrono::steady_clock::now().time_since_epoch()};
+    play_time_ = std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+  }
+}
 
-void SdlAudio::stop() { SDL_PauseAudioDevice(device_, 1); }
\ No newline at end of file
+void SdlAudio::stop() { playing_ = false; }
+
+void SdlAudio::set_pattern(const std::array<uint8_t, 16>& pattern) {
+  uint64_t high{0};
+  uint64_t low{0};
+  for (std::size_t i = 0; i < 8; ++i) {
+    high = high << 8 | pattern.at(i);
+    low = low << 8 | pattern.at(i + 8);
+  }
+  pattern_high_ = high;
+  pattern_low_ = low;
+}
+
+void SdlAudio::set_pitch(uint8_t pitch) { pitch_ = pitch; }
+
+AudioLatency SdlAudio::latency() const {
+  AudioLatency latency{};
+  latency.buffer = std::chrono::nanoseconds(std::chrono::seconds(1)) * spec_.samples / spec_.freq;
+  latency.starts = starts_;
+  if (latency.starts > 0) {
+    latency.mean_start = std::chrono::nanoseconds(total_start_ / static_cast<int64_t>(latency.starts));
+  }
+  latency.max_start = std::chrono::nanoseconds(max_start_);
+  return latency;
+}
+
+void SdlAudio::callback(void* userdata, Uint8* stream, int len) {
+  // Ignoring due to SDL interface.
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  auto* samples{reinterpret_cast<int16_t*>(stream)};
+  static_cast<SdlAudio*>(userdata)->generate({samples, static_cast<std::size_t>(len) / sizeof(int16_t)});
+}
+
+void SdlAudio::generate(std::span<int16_t> samples) {
+  if (!playing_) {
+    std::fill(samples.begin(), samples.end(), 0);
+    position_ = 0;
+    return;
+  }
+
+  auto play_time{play_time_.exchange(0)};
+  if (play_time != 0) {
+    auto now{std::chrono::steady_clock::now().time_since_epoch()};
+    auto start{std::chrono::duration_cast<std::chrono::nanoseconds>(now).count() - play_time};
+    ++starts_;
+    total_start_ += start;
+    max_start_ = std::max<int64_t>(max_start_, start);
+  }
+
+  // 4000 bits per second at pitch 64, an octave per 48 steps.
+  const auto rate{4000.0 * std::pow(2.0, (pitch_ - 64) / 48.0)};
+  const auto step{rate / spec_.freq};
+  const uint64_t high{pattern_high_};
+  const uint64_t low{pattern_low_};
+  const int16_t amplitude{3000};
+
+  for (auto& sample : samples) {
+    auto bit{static_cast<unsigned>(position_)};
+    auto word{bit < 64 ? high : low};
+    sample = (word >> (63 - bit % 64) & 1U) != 0 ? amplitude : static_cast<int16_t>(-amplitude);
+    position_ += step;
+    if (position_ >= 128) {
+      position_ -= 128;
+    }
+  }
+}
@@ -2,81 +2,196 @@
 
 #include <SDL2/SDL.h>
 
-#include <condition_variable>
-#include <memory>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <span>
+#include <string>
+
+// Key masks have bit n set if key n is pressed. Map of keys:
+// 1 2 3 C
+// 4 5 6 D
+// 7 8 9 E
+// A 0 B F
 
 class EmptyInput {
  public:
-  // Get value. Map of keys.
-  // 1 2 3 C
-  // 4 5 6 D
-  // 7 8 9 E
-  // A 0 B F
-  std::array<bool, 16> key_state();
+  uint16_t key_mask() const { return keys_; }
 
   // Set state of a key.
   void set_key_state(int key, bool state);
 
+  // Set state of all keys.
+  void set_key_mask(uint16_t keys) { keys_ = keys; }
+
  private:
-  std::array<bool, 16> state_;
+  uint16_t keys_{0};
 };
 
+// Keyboard input. Events are handled by poll() on the thread owning the
+// window, which publishes the key mask for the emulation to read.
 class SdlInput {
  public:
-  // Get value. Map of keys.
-  // 1 2 3 C
-  // 4 5 6 D
-  // 7 8 9 E
-  // A 0 B F
-  std::array<bool, 16> key_state();
+  // Wait up to timeout_ms for events, then handle all pending ones.
+  void poll(int timeout_ms);
+
+  uint16_t key_mask() const { return keys_.load(std::memory_order_relaxed); }
 
   bool emulator_active() const;
-  std::condition_variable& emulator_active_cv();
+
+  // Whether rewind hotkey (Backspace) was held at the last poll().
+  bool rewind_held() const;
+
+  // Whether fast-forward hotkey (Tab) was held at the last poll().
+  bool fast_forward_held() const;
+
+  // Whether the window was exposed or resized since the last call, so its
+  // contents must be drawn again.
+  bool take_redraw();
 
  private:
-  bool emulator_active_{true};
-  std::condition_variable cv_;
+  std::atomic<uint16_t> keys_{0};
+  std::atomic<bool> emulator_active_{true};
+  std::atomic<bool> rewind_held_{false};
+  std::atomic<bool> fast_forward_held_{false};
+  std::atomic<bool> redraw_{false};
 };
 
+// Base for graphics backends. The framebuffer is stored as one 64-bit word
+// per row, with the leftmost pixel in the most significant bit. Tracks which
+// rows changed since the last present(), so the backend's
+// render(first_row, last_row) is only invoked when there is something to draw.
+// Not synchronized: drawing and present() must run on the same thread.
 template <typename Impl>
 class Gfx {
  public:
-  Gfx() : map_{} {}
+  Gfx() : rows_{} {}
 
   // Set value of a pixel.
   void set_pixel(int x, int y, bool value) {
     // Prevent out-of-bounds write.
-    auto pos{y * chip8_width + x};
-    if (pos >= chip8_height * chip8_width) {
+    if (x < 0 || x >= chip8_width || y < 0 || y >= chip8_height) {
       return;
     }
-    map_.at(pos) = value;
+    auto mask{pixel_mask(x)};
+    auto row{value ? rows_[y] | mask : rows_[y] & ~mask};
+    if (row == rows_[y]) {
+      return;
+    }
+    rows_[y] = row;
+    mark_dirty(y, y);
   }
 
   // Get value of a pixel.
   bool pixel(int x, int y) const {
     // Prevent out-of-bounds read.
-    auto pos{y * chip8_width + x};
-    if (pos >= chip8_height * chip8_width) {
+    if (x < 0 || x >= chip8_width || y < 0 || y >= chip8_height) {
       return false;
     }
 
-    return map_.at(pos);
+    return (rows_[y] & pixel_mask(x)) != 0;
+  }
+
+  // Get pixels of a row.
+  uint64_t row(int y) const { return rows_.at(y); }
+
+  // Get whole framebuffer, one word per row.
+  const std::array<uint64_t, 32>& rows() const { return rows_; }
+
+  // Replace whole framebuffer.
+  void set_rows(const std::array<uint64_t, 32>& rows) {
+    rows_ = rows;
+    mark_dirty(0, chip8_height - 1);
+  }
+
+  // XOR sprite onto the screen at (x, y), one byte per row. Starting position
+  // wraps around the screen, parts of the sprite past the edges are clipped,
+  // or wrapped if Wrap is set. Returns true if any lit pixel was erased.
+  template <bool Wrap = false>
+  bool draw_sprite(int x, int y, std::span<const uint8_t> sprite) {
+    x %= chip8_width;
+    y %= chip8_height;
+
+    uint64_t collision{0};
+    int last_row{y};
+    for (std::size_t i = 0; i < sprite.size(); ++i) {
+      int row{y + static_cast<int>(i)};
+      if (row >= chip8_height) {
+        if constexpr (!Wrap) {
+          break;
+        }
+        row -= chip8_height;
+      }
+
+      auto bits{static_cast<uint64_t>(sprite[i]) << (chip8_width - 8)};
+      auto line{bits >> x};
+      if constexpr (Wrap) {
+        if (x > chip8_width - 8) {
+          line |= bits << (chip8_width - x);
+        }
+      }
+
+      collision |= rows_[row] & line;
+      rows_[row] ^= line;
+      last_row = y + static_cast<int>(i);
+    }
+
+    if (last_row >= chip8_height) {
+      mark_dirty(0, chip8_height - 1);
+    } else if (!sprite.empty()) {
+      mark_dirty(y, last_row);
+    }
+
+    return collision != 0;
   }
 
   // Clear screen.
-  void clear_screen() { map_ = {}; }
+  void clear_screen() {
+    rows_ = {};
+    mark_dirty(0, chip8_height - 1);
+  }
+
+  // Mark all rows changed, so the next present() renders the whole screen,
+  // e.g. after the window lost its contents.
+  void redraw() { mark_dirty(0, chip8_height - 1); }
+
+  // Whether any row changed since the last present().
+  bool dirty() const { return dirty_first_ <= dirty_last_; }
+
+  // Render changed rows, if any. Should be invoked once per frame.
+  void present() {
+    if (!dirty()) {
+      return;
+    }
+    static_cast<Impl*>(this)->render(dirty_first_, dirty_last_);
+    dirty_first_ = chip8_height;
+    dirty_last_ = -1;
+  }
 
  protected:
   static const int chip8_width{64};
   static const int chip8_height{32};
-  std::array<bool, chip8_width * chip8_height> map_;
+  std::array<uint64_t, chip8_height> rows_;
+
+  static uint64_t pixel_mask(int x) { return uint64_t{1} << (chip8_width - 1 - x); }
+
+ private:
+  // Inclusive range of rows changed since the last present().
+  int dirty_first_{0};
+  int dirty_last_{chip8_height - 1};
+
+  void mark_dirty(int first_row, int last_row) {
+    dirty_first_ = std::min(dirty_first_, first_row);
+    dirty_last_ = std::max(dirty_last_, last_row);
+  }
 };
 
 class EmptyGfx : public Gfx<EmptyGfx> {
  public:
   // Do nothing.
-  void render() {}
+  void render(int /*first_row*/, int /*last_row*/) {}
 };
 
 class SdlGfx : public Gfx<SdlGfx> {
@@ -84,8 +199,10 @@ class SdlGfx : public Gfx<SdlGfx> {
   SdlGfx(int window_width, int window_height);
   ~SdlGfx();
 
-  // Render to screen.
-  void render();
+  // Render rows [first_row, last_row] to screen.
+  void render(int first_row, int last_row);
+
+  void set_title(const std::string& title);
 
  private:
   int width_{};
@@ -94,22 +211,90 @@ class SdlGfx : public Gfx<SdlGfx> {
   SDL_Surface* surface_{};
 };
 
+// Renders through a 64x32 streaming texture, scaled to the window by a single
+// SDL_RenderCopy.
+class SdlTextureGfx : public Gfx<SdlTextureGfx> {
+ public:
+  SdlTextureGfx(int window_width, int window_height);
+  ~SdlTextureGfx();
+
+  // Render rows [first_row, last_row] to screen.
+  void render(int first_row, int last_row);
+
+  void set_title(const std::string& title);
+
+ private:
+  SDL_Window* window_{};
+  SDL_Renderer* renderer_{};
+  SDL_Texture* texture_{};
+  Uint32 color_on_{};
+  Uint32 color_off_{};
+};
+
+// Audio pattern played until a game loads its own: a square wave with a
+// period of 16 bits, 250 Hz at the default pitch.
+constexpr std::array<uint8_t, 16> default_audio_pattern{0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00,
+                                                        0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00};
+// Pitch at which the pattern plays at 4000 bits per second.
+constexpr uint8_t default_pitch{64};
+
 class EmptyAudio {
  public:
   void play() {}
   void stop() {}
+  void set_pattern(const std::array<uint8_t, 16>& /*pattern*/) {}
+  void set_pitch(uint8_t /*pitch*/) {}
 };
 
+// Delay between play() and the tone reaching the speaker.
+struct AudioLatency {
+  // Time the device takes to play one buffer.
+  std::chrono::nanoseconds buffer{0};
+  // Tone starts measured.
+  uint64_t starts{0};
+  // Time from play() to the callback generating the first samples of the tone.
+  std::chrono::nanoseconds mean_start{0};
+  std::chrono::nanoseconds max_start{0};
+};
+
+// Generates the tone on demand in the SDL audio callback, from the 128-bit
+// audio pattern played at the rate set by pitch. play() and stop() only flip
+// a flag, so the tone starts and stops within one buffer.
 class SdlAudio {
  public:
-  SdlAudio();
+  explicit SdlAudio(int buffer_samples = 256);
   ~SdlAudio();
 
+  SdlAudio(const SdlAudio&) = delete;
+  SdlAudio& operator=(const SdlAudio&) = delete;
+
   void play();
   void stop();
+  void set_pattern(const std::array<uint8_t, 16>& pattern);
+  void set_pitch(uint8_t pitch);
+
+  AudioLatency latency() const;
 
  private:
+  static void callback(void* userdata, Uint8* stream, int len);
+
+  // Fill samples with the tone, or silence. Runs on the audio thread.
+  void generate(std::span<int16_t> samples);
+
   SDL_AudioDeviceID device_{};
   SDL_AudioSpec spec_{};
-  std::unique_ptr<int16_t[]> sample_{};
-};
\ No newline at end of file
+
+  std::atomic<bool> playing_{false};
+  // Pattern bits 0-63 and 64-127, first bit played is the most significant.
+  std::atomic<uint64_t> pattern_high_{};
+  std::atomic<uint64_t> pattern_low_{};
+  std::atomic<uint8_t> pitch_{default_pitch};
+  // Position in the pattern, in bits. Audio thread only.
+  double position_{0};
+
+  // Steady clock time of a play() not yet picked up by the callback, 0 if none.
+  std::atomic<int64_t> play_time_{0};
+  std::atomic<uint64_t> starts_{0};
+  std::atomic<int64_t> total_start_{0};
+  std::atomic<int64_t> max_start_{0};
+};
@@ -0,0 +1,93 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(std::size_t threads) {
+  threads = std::max<std::size_t>(threads, 1);
+  for (std::size_t i = 0; i < threads; ++i) {
+    queues_.push_back(std::make_unique<Queue>());
+  }
+  for (std::size_t i = 0; i < threads; ++i) {
+    workers_.emplace_back([this, i]() { work(i); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    stopping_ = true;
+  }
+  work_available_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+void ThreadPool::submit(Task task) {
+  auto& queue{*queues_[next_queue_++ % queues_.size()]};
+  ++pending_;
+  {
+    // Counted before the task is published, so a worker taking it at once
+    // can't decrement the count below zero. Under mutex_, so a worker can't
+    // miss it between checking and waiting.
+    std::lock_guard<std::mutex> lock{mutex_};
+    ++queued_;
+  }
+  {
+    std::lock_guard<std::mutex> lock{queue.mutex};
+    queue.tasks.push_back(std::move(task));
+  }
+  work_available_.notify_one();
+}
+
+void ThreadPool::wait() {
+  std::unique_lock<std::mutex> lock{mutex_};
+  all_done_.wait(lock, [this]() { return pending_ == 0; });
+}
+
+void ThreadPool::work(std::size_t index) {
+  Task task;
+  while (true) {
+    if (take(index, task)) {
+      task();
+      task = nullptr;
+      if (--pending_ == 0) {
+        std::lock_guard<std::mutex> lock{mutex_};
+        all_done_.notify_all();
+      }
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock{mutex_};
+    work_available_.wait(lock, [this]() { return stopping_ || queued_ > 0; });
+    if (stopping_ && queued_ == 0) {
+      return;
+    }
+  }
+}
+
+bool ThreadPool::take(std::size_t index, Task& task) {
+  {
+    auto& own{*queues_[index]};
+    std::lock_guard<std::mutex> lock{own.mutex};
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      --queued_;
+      return true;
+    }
+  }
+
+  for (std::size_t i = 1; i < queues_.size(); ++i) {
+    auto& other{*queues_[(index + i) % queues_.size()]};
+    std::lock_guard<std::mutex> lock{other.mutex};
+    if (!other.tasks.empty()) {
+      task = std::move(other.tasks.front());
+      other.tasks.pop_front();
+      --queued_;
+      ++steals_;
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads, each with its own queue of tasks. A worker runs
+// tasks from the back of its queue and, once it is empty, steals from the
+// front of the others, so uneven tasks still keep every thread busy. Queues
+// are only contended while stealing.
+class ThreadPool {
+ public:
+  using Task = std::function<void()>;
+
+  explicit ThreadPool(std::size_t threads = std::thread::hardware_concurrency());
+  // Finishes queued tasks before returning.
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Queue task, spreading tasks over workers round-robin. May be called from tasks.
+  void submit(Task task);
+
+  // Wait until all submitted tasks are finished.
+  void wait();
+
+  std::size_t size() const { return workers_.size(); }
+
+  // Tasks run by a worker other than the one they were queued to.
+  std::size_t steals() const { return steals_; }
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> workers_;
+  std::atomic<std::size_t> next_queue_{0};
+  // Tasks queued and not yet taken by a worker.
+  std::atomic<std::size_t> queued_{0};
+  // Tasks submitted and not yet finished.
+  std::atomic<std::size_t> pending_{0};
+  std::atomic<std::size_t> steals_{0};
+  bool stopping_{false};
+  // Guards stopping_ and waiting on the condition variables.
+  std::mutex mutex_;
+  std::condition_variable work_available_;
+  std::condition_variable all_done_;
+
+  void work(std::size_t index);
+
+  // Take task from given worker's own queue, or steal one from another.
+  bool take(std::size_t index, Task& task);
+};
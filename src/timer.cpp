@@ -1,21 +1,43 @@
 #include "timer.h"
 
-Timer::Timer(Interval interval, Callback callback)
-    : interval_{interval}, callback_{std::move(callback)}, running_{true}, thread_{[&]() {
-        auto prev_time{std::chrono::system_clock::now()};
-        while (running_) {
-          auto until_time{prev_time + interval_};
+#include <algorithm>
+#include <utility>
 
-          callback_();
+Pacer::Pacer(Interval interval, Overrun overrun, TimeSource time)
+    : time_{std::move(time)}, interval_{interval}, overrun_{overrun}, next_{time_.now() + interval} {}
 
-          std::this_thread::sleep_until(until_time);
-          prev_time = until_time;
-        }
-      }} {}
+void Pacer::wait() {
+  auto now{time_.now()};
+  if (now < next_) {
+    time_.sleep_until(next_);
+    now = time_.now();
+  }
 
-Timer::~Timer() {
-  running_ = false;
-  thread_.join();
+  auto late{std::chrono::duration_cast<std::chrono::nanoseconds>(now - next_)};
+  if (late >= interval_) {
+    ++stats_.overruns;
+    if (overrun_ == Overrun::skip) {
+      auto missed{late / interval_};
+      next_ += missed * interval_;
+      stats_.skipped += static_cast<uint64_t>(missed);
+    }
+  }
+
+  ++stats_.ticks;
+  total_jitter_ += late;
+  stats_.max_jitter = std::max(stats_.max_jitter, late);
+  next_ += interval_;
+}
+
+void Pacer::set_interval(Interval interval) {
+  interval_ = interval;
+  next_ = time_.now() + interval;
 }
 
-void Timer::set_interval(Interval interval) { interval_ = interval; }
\ No newline at end of file
+TimerStats Pacer::stats() const {
+  auto stats{stats_};
+  if (stats.ticks > 0) {
+    stats.mean_jitter = total_jitter_ / stats.ticks;
+  }
+  return stats;
+}
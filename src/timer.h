@@ -1,22 +1,67 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
 #include <functional>
 #include <thread>
 
-class Timer {
+// What a clock does when it falls more than an interval behind schedule.
+enum class Overrun {
+  // Run missed ticks back to back until on schedule again.
+  catch_up,
+  // Drop missed ticks, continuing on the original schedule.
+  skip,
+};
+
+// Tick timing statistics. Jitter is how late a tick started relative to its schedule.
+struct TimerStats {
+  uint64_t ticks{0};
+  // Ticks started an interval or more behind schedule.
+  uint64_t overruns{0};
+  // Ticks dropped by Overrun::skip.
+  uint64_t skipped{0};
+  std::chrono::nanoseconds mean_jitter{0};
+  std::chrono::nanoseconds max_jitter{0};
+};
+
+// Where a Pacer reads the time and how it sleeps: the steady clock and the
+// calling thread by default, replaced by simulated time in tests.
+struct TimeSource {
+  using Clock = std::chrono::steady_clock;
+
+  std::function<Clock::time_point()> now{[]() { return Clock::now(); }};
+  std::function<void(Clock::time_point)> sleep_until{
+      [](Clock::time_point time) { std::this_thread::sleep_until(time); }};
+};
+
+// Ticks at a fixed interval on the steady clock, on the calling thread.
+// Ticks are scheduled from the start time rather than from the previous
+// wake-up, so sleep inaccuracy does not accumulate into drift.
+class Pacer {
  public:
-  using Interval = std::chrono::milliseconds;
-  using Callback = std::function<void()>;
+  using Clock = TimeSource::Clock;
+  using Interval = std::chrono::nanoseconds;
+
+  explicit Pacer(Interval interval, Overrun overrun = Overrun::catch_up, TimeSource time = {});
+
+  // Sleep until the next tick is due.
+  void wait();
+
+  // Change interval, starting a new schedule from now.
+  void set_interval(Interval interval);
+
+  Interval interval() const { return interval_; }
 
-  Timer(Interval interval, Callback callback);
-  ~Timer();
+  // When the next tick is due.
+  Clock::time_point next_tick() const { return next_; }
 
-  void set_interval(Interval new_interval);
+  TimerStats stats() const;
 
  private:
+  TimeSource time_;
   Interval interval_;
-  Callback callback_;
-  bool running_;
-  std::thread thread_;
-};
\ No newline at end of file
+  Overrun overrun_;
+  Clock::time_point next_;
+  TimerStats stats_{};
+  std::chrono::nanoseconds total_jitter_{0};
+};
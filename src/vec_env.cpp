@@ -0,0 +1,186 @@
+#include "vec_env.h"
+
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+
+#include "chip8.h"
+#include "memory.h"
+#include "sdl.h"
+
+namespace {
+
+const std::size_t ram_size{0x1000};
+// Chunks of environments per worker thread of a step, so workers that finish
+// early can take more.
+const std::size_t chunks_per_thread{4};
+
+}  // namespace
+
+// One environment: a machine, its start state and the current episode.
+class VecEnv::Env {
+ public:
+  Env(std::span<const uint8_t> game, const VecEnvConfig& config, uint64_t seed_stride)
+      : config_{config}, chip8_{gfx_, input_, audio_}, seed_stride_{seed_stride} {
+    // Faults end the episode in release builds too.
+    chip8_.set_trap(memory::throw_fault);
+    chip8_.load(game);
+    chip8_.snapshot(start_);
+  }
+
+  void reset(uint64_t seed, std::span<uint8_t> observation) {
+    start_episode(seed);
+    write_observation(observation);
+  }
+
+  void step(uint16_t action, std::span<uint8_t> observation, float& reward, uint8_t& done) {
+    input_.set_key_mask(action);
+    reward = 0.0F;
+    for (const auto& probe : config_.rewards) {
+      reward -= probe.weight * static_cast<float>(chip8_.ram(probe.address));
+    }
+
+    bool ended{false};
+    try {
+      for (std::size_t i = 0; i < config_.frame_skip && !ended; ++i) {
+        chip8_.step_frame(config_.cycles_per_frame);
+        ++frames_;
+        ended = episode_ended();
+      }
+    } catch (const std::exception&) {
+      // Machine faulted.
+      ended = true;
+    }
+
+    for (const auto& probe : config_.rewards) {
+      reward += probe.weight * static_cast<float>(chip8_.ram(probe.address));
+    }
+    done = ended ? 1 : 0;
+    if (ended) {
+      start_episode(seed_ + seed_stride_);
+    }
+    write_observation(observation);
+  }
+
+ private:
+  using Machine = Chip8<EmptyGfx, EmptyInput, EmptyAudio, quirks::CosmacVip, NullProfiler, memory::Frontend>;
+
+  const VecEnvConfig& config_;
+  EmptyGfx gfx_{};
+  EmptyInput input_{};
+  EmptyAudio audio_{};
+  Machine chip8_;
+  Machine::Snapshot start_{};
+  // Seeds of successive episodes of an environment are seed_stride_ apart,
+  // so no two episodes of a VecEnv share one.
+  uint64_t seed_stride_;
+  uint64_t seed_{0};
+  uint64_t frames_{0};
+
+  void start_episode(uint64_t seed) {
+    chip8_.restore(start_);
+    chip8_.seed(seed);
+    input_.set_key_mask(0);
+    seed_ = seed;
+    frames_ = 0;
+  }
+
+  bool episode_ended() const {
+    if (config_.max_frames != 0 && frames_ >= config_.max_frames) {
+      return true;
+    }
+    return std::any_of(config_.done.begin(), config_.done.end(),
+                       [this](const DoneProbe& probe) { return chip8_.ram(probe.address) == probe.value; });
+  }
+
+  void write_observation(std::span<uint8_t> observation) const {
+    const auto& rows{gfx_.rows()};
+    const std::size_t width{64};
+    for (std::size_t y = 0; y < rows.size(); ++y) {
+      for (std::size_t x = 0; x < width; ++x) {
+        observation[y * width + x] = static_cast<uint8_t>(rows[y] >> (width - 1 - x) & 1U);
+      }
+    }
+  }
+};
+
+VecEnv::VecEnv(std::span<const uint8_t> game, const VecEnvConfig& config)
+    : config_{config}, pool_{config.threads > 0 ? config.threads : std::thread::hardware_concurrency()} {
+  if (config_.envs == 0 || config_.frame_skip == 0) {
+    throw std::invalid_argument("No environments or frames per step.");
+  }
+  auto out_of_ram{[](uint16_t address) { return address >= ram_size; }};
+  if (std::any_of(config_.rewards.begin(), config_.rewards.end(),
+                  [&](const RewardProbe& probe) { return out_of_ram(probe.address); }) ||
+      std::any_of(config_.done.begin(), config_.done.end(),
+                  [&](const DoneProbe& probe) { return out_of_ram(probe.address); })) {
+    throw std::invalid_argument("Probe address out of RAM.");
+  }
+
+  for (std::size_t i = 0; i < config_.envs; ++i) {
+    envs_.push_back(std::make_unique<Env>(game, config_, config_.envs));
+  }
+  auto chunks{pool_.size() * chunks_per_thread};
+  chunk_ = (config_.envs + chunks - 1) / chunks;
+}
+
+VecEnv::~VecEnv() = default;
+
+template <typename Task>
+void VecEnv::for_chunks(Task task) {
+  // Queues hold one task per worker however many environments there are, and
+  // workers that finish early take more chunks instead of stealing tasks.
+  next_chunk_ = 0;
+  const auto workers{std::min(pool_.size(), (size() + chunk_ - 1) / chunk_)};
+  for (std::size_t worker = 0; worker < workers; ++worker) {
+    // Captures fit in std::function without allocating.
+    pool_.submit([this, &task]() {
+      for (auto first{next_chunk_.fetch_add(chunk_)}; first < size(); first = next_chunk_.fetch_add(chunk_)) {
+        task(first);
+      }
+    });
+  }
+  pool_.wait();
+}
+
+void VecEnv::reset(uint64_t seed, std::span<uint8_t> observations) {
+  check_observations(observations);
+  for_chunks([&](std::size_t first) {
+    for (std::size_t i = first; i < std::min(first + chunk_, size()); ++i) {
+      envs_[i]->reset(seed + i, observations.subspan(i * observation_size, observation_size));
+    }
+  });
+}
+
+void VecEnv::step(std::span<const uint16_t> actions, std::span<uint8_t> observations, std::span<float> rewards,
+                  std::span<uint8_t> done) {
+  check_observations(observations);
+  if (actions.size() != size() || rewards.size() != size() || done.size() != size()) {
+    throw std::invalid_argument("Wrong number of actions, rewards or done flags.");
+  }
+
+  auto start{std::chrono::steady_clock::now()};
+  for_chunks([&](std::size_t first) {
+    for (std::size_t i = first; i < std::min(first + chunk_, size()); ++i) {
+      envs_[i]->step(actions[i], observations.subspan(i * observation_size, observation_size), rewards[i], done[i]);
+    }
+  });
+  step_time_ += std::chrono::steady_clock::now() - start;
+  steps_ += size();
+}
+
+double VecEnv::steps_per_second() const {
+  auto seconds{std::chrono::duration<double>(step_time_).count()};
+  return seconds > 0 ? static_cast<double>(steps_) / seconds : 0.0;
+}
+
+void VecEnv::check_observations(std::span<uint8_t> observations) const {
+  if (observations.size() != size() * observation_size) {
+    throw std::invalid_argument("Wrong observation buffer size.");
+  }
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  if (reinterpret_cast<std::uintptr_t>(observations.data()) % observation_alignment != 0) {
+    throw std::invalid_argument("Observation buffer not aligned.");
+  }
+}
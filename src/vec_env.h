@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "thread_pool.h"
+
+// Reward from a byte of RAM, e.g. a score counter: weight times its change
+// over a step.
+struct RewardProbe {
+  uint16_t address;
+  float weight{1.0F};
+};
+
+// Episode ends when a byte of RAM, e.g. a lives counter, holds given value.
+struct DoneProbe {
+  uint16_t address;
+  uint8_t value;
+};
+
+struct VecEnvConfig {
+  std::size_t envs{1};
+  // Frames run per step, with the action held down for all of them.
+  std::size_t frame_skip{4};
+  std::size_t cycles_per_frame{10};
+  std::vector<RewardProbe> rewards{};
+  std::vector<DoneProbe> done{};
+  // Frames after which an episode ends, 0 for no limit.
+  uint64_t max_frames{0};
+  // Worker threads, 0 for one per core.
+  std::size_t threads{0};
+};
+
+// Many headless machines running one game with CosmacVip quirks, as
+// environments for training agents. Actions are key masks, one per
+// environment.
+//
+// Observations are written straight into a buffer owned by the caller,
+// observation_size bytes per environment, one byte per pixel (0 or 1) row by
+// row. The buffer must be aligned to observation_alignment, and as
+// observation_size is a multiple of it, so is every observation.
+//
+// An episode ends on a done probe, after max_frames or if the machine faults.
+// The environment is then reset at once, and its observation is the first of
+// the next episode.
+class VecEnv {
+ public:
+  static constexpr std::size_t observation_size{64 * 32};
+  static constexpr std::size_t observation_alignment{64};
+
+  // Throws std::invalid_argument if config has no environments or frames per
+  // step, or a probe address is out of RAM.
+  VecEnv(std::span<const uint8_t> game, const VecEnvConfig& config);
+  ~VecEnv();
+
+  VecEnv(const VecEnv&) = delete;
+  VecEnv& operator=(const VecEnv&) = delete;
+
+  std::size_t size() const { return envs_.size(); }
+
+  // Start a new episode in every environment, environment i seeded with
+  // seed + i, and write their observations.
+  void reset(uint64_t seed, std::span<uint8_t> observations);
+
+  // Run one step of every environment with given actions. Writes
+  // observations, rewards and whether the episode ended, one per
+  // environment. Throws std::invalid_argument if a buffer has the wrong size
+  // or observations are misaligned.
+  void step(std::span<const uint16_t> actions, std::span<uint8_t> observations, std::span<float> rewards,
+            std::span<uint8_t> done);
+
+  // Environment steps run by step() so far.
+  uint64_t steps() const { return steps_; }
+
+  // Environment steps per second of time spent in step().
+  double steps_per_second() const;
+
+ private:
+  class Env;
+
+  VecEnvConfig config_;
+  std::vector<std::unique_ptr<Env>> envs_;
+  ThreadPool pool_;
+  // Environments stepped at a time by a worker.
+  std::size_t chunk_;
+  // First environment of the next chunk to step.
+  std::atomic<std::size_t> next_chunk_{0};
+  uint64_t steps_{0};
+  std::chrono::steady_clock::duration step_time_{};
+
+  void check_observations(std::span<uint8_t> observations) const;
+
+  // Run task(first) on ranges of chunk_ environments from first in parallel,
+  // one task per worker taking ranges until none are left.
+  template <typename Task>
+  void for_chunks(Task task);
+};
@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "chip8.h"
+#include "sdl.h"
+
+// Records every render() call.
+class RecordingGfx : public Gfx<RecordingGfx> {
+ public:
+  void render(int first_row, int last_row) { renders.emplace_back(first_row, last_row); }
+
+  std::vector<std::pair<int, int>> renders;
+};
+
+class GfxTest : public ::testing::Test {
+ public:
+  GfxTest() : gfx{} { gfx.present(); }
+
+  RecordingGfx gfx;
+};
+
+TEST_F(GfxTest, InitialPresentRendersWholeScreen) {
+  ASSERT_EQ(gfx.renders.size(), 1);
+  ASSERT_EQ(gfx.renders.back(), std::make_pair(0, 31));
+  ASSERT_FALSE(gfx.dirty());
+}
+
+TEST_F(GfxTest, PresentWithoutChangesDoesNotRender) {
+  gfx.present();
+  gfx.present();
+  ASSERT_EQ(gfx.renders.size(), 1);
+}
+
+TEST_F(GfxTest, RedrawRendersWholeScreen) {
+  gfx.redraw();
+  ASSERT_TRUE(gfx.dirty());
+
+  gfx.present();
+  ASSERT_EQ(gfx.renders.size(), 2);
+  ASSERT_EQ(gfx.renders.back(), std::make_pair(0, 31));
+}
+
+TEST_F(GfxTest, SetPixelMarksChangedRows) {
+  gfx.set_pixel(3, 7, true);
+  gfx.set_pixel(60, 12, true);
+  ASSERT_TRUE(gfx.dirty());
+
+  gfx.present();
+  ASSERT_EQ(gfx.renders.size(), 2);
+  ASSERT_EQ(gfx.renders.back(), std::make_pair(7, 12));
+  ASSERT_FALSE(gfx.dirty());
+}
+
+TEST_F(GfxTest, SetPixelToSameValueIsNotDirty) {
+  gfx.set_pixel(3, 7, false);
+  ASSERT_FALSE(gfx.dirty());
+}
+
+TEST_F(GfxTest, ClearScreenMarksAllRows) {
+  gfx.clear_screen();
+  gfx.present();
+  ASSERT_EQ(gfx.renders.back(), std::make_pair(0, 31));
+}
+
+TEST_F(GfxTest, ExecuteCycleDoesNotRender) {
+  EmptyInput in;
+  EmptyAudio audio;
+  Chip8<RecordingGfx, EmptyInput, EmptyAudio> c{gfx, in, audio};
+
+  // CLS, then LD V0,NN.
+  c.load({0x00, 0xE0, 0x60, 0x01});
+  c.execute_cycle();
+  c.execute_cycle();
+  ASSERT_EQ(gfx.renders.size(), 1);
+
+  c.update_timers();
+  ASSERT_EQ(gfx.renders.size(), 1);
+
+  c.run_frame(0);
+  ASSERT_EQ(gfx.renders.size(), 2);
+}
+
+TEST_F(GfxTest, TimerTicksKeepDirtyRowsForNextFrame) {
+  EmptyInput in;
+  EmptyAudio audio;
+  Chip8<RecordingGfx, EmptyInput, EmptyAudio> c{gfx, in, audio};
+
+  // LD V0,NN, then LD F,V0, then DRW V0,V0,5 at (8, 8).
+  c.load({0x60, 0x08, 0xF0, 0x29, 0xD0, 0x05});
+  c.run(3);
+  c.update_timers();
+  c.update_timers();
+  ASSERT_EQ(gfx.renders.size(), 1);
+  ASSERT_TRUE(gfx.dirty());
+
+  c.run_frame(0);
+  ASSERT_EQ(gfx.renders.back(), std::make_pair(8, 12));
+}
+
+TEST_F(GfxTest, RunFramePresentsOnce) {
+  EmptyInput in;
+  EmptyAudio audio;
+  Chip8<RecordingGfx, EmptyInput, EmptyAudio> c{gfx, in, audio};
+
+  // LD V0,NN, then LD F,V0, then DRW V0,V0,5 and ADD V0,NN forever.
+  c.load({0x60, 0x00, 0xF0, 0x29, 0xD0, 0x05, 0x70, 0x08, 0x12, 0x04});
+  c.run_frame(20);
+  ASSERT_EQ(gfx.renders.size(), 2);
+  ASSERT_EQ(c.cycles(), 20);
+}
+
+TEST_F(GfxTest, DrawSpriteXorsAndReportsCollision) {
+  const std::array<uint8_t, 2> sprite{0b11000000, 0b10000001};
+
+  ASSERT_FALSE(gfx.draw_sprite(8, 4, sprite));
+  ASSERT_EQ(gfx.row(4), uint64_t{0b11} << 54);
+  ASSERT_EQ(gfx.row(5), uint64_t{0b10000001} << 48);
+
+  ASSERT_TRUE(gfx.draw_sprite(8, 4, sprite));
+  ASSERT_EQ(gfx.row(4), 0);
+  ASSERT_EQ(gfx.row(5), 0);
+
+  gfx.present();
+  ASSERT_EQ(gfx.renders.back(), std::make_pair(4, 5));
+}
+
+TEST_F(GfxTest, DrawSpriteWrapsStartingPosition) {
+  const std::array<uint8_t, 1> sprite{0x80};
+
+  gfx.draw_sprite(64 + 3, 32 + 2, sprite);
+  ASSERT_TRUE(gfx.pixel(3, 2));
+}
+
+TEST_F(GfxTest, DrawSpriteClipsAtEdges) {
+  const std::array<uint8_t, 2> sprite{0xFF, 0xFF};
+
+  gfx.draw_sprite(60, 31, sprite);
+  ASSERT_EQ(gfx.row(31), 0xF);
+  ASSERT_EQ(gfx.row(0), 0);
+}
+
+TEST_F(GfxTest, DrawSpriteWrapsAtEdges) {
+  const std::array<uint8_t, 2> sprite{0xFF, 0xFF};
+
+  gfx.draw_sprite<true>(60, 31, sprite);
+  ASSERT_EQ(gfx.row(31), 0xF00000000000000F);
+  ASSERT_EQ(gfx.row(0), 0xF00000000000000F);
+
+  gfx.present();
+  ASSERT_EQ(gfx.renders.back(), std::make_pair(0, 31));
+}
@@ -0,0 +1,212 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+#include "chip8.h"
+#include "lockstep.h"
+#include "memory.h"
+#include "profiler.h"
+#include "quirks.h"
+#include "random.h"
+#include "sdl.h"
+
+namespace {
+
+const std::size_t lanes{8};
+const std::size_t program_size{48};
+
+// Random program of valid opcodes, jumps and calls staying inside it, with
+// the XO-CHIP audio opcodes if Audio is set.
+template <bool Audio>
+std::vector<uint8_t> random_program(Pcg32& rng) {
+  std::vector<uint16_t> templates{0x00E0, 0x00EE, 0x1000, 0x2000, 0x3000, 0x4000, 0x5000, 0x6000, 0x7000,
+                                  0x8000, 0x8001, 0x8002, 0x8003, 0x8004, 0x8005, 0x8006, 0x8007, 0x800E,
+                                  0x9000, 0xA000, 0xB000, 0xC000, 0xD000, 0xE09E, 0xE0A1, 0xF007, 0xF00A,
+                                  0xF015, 0xF018, 0xF01E, 0xF029, 0xF033, 0xF055, 0xF065};
+  if constexpr (Audio) {
+    templates.push_back(0xF002);
+    templates.push_back(0xF03A);
+  }
+  std::vector<uint8_t> program;
+  for (std::size_t i = 0; i < program_size; ++i) {
+    auto opcode{templates[rng() % templates.size()]};
+    auto x{static_cast<uint16_t>(rng() % 16 << 8)};
+    auto y{static_cast<uint16_t>(rng() % 16 << 4)};
+    auto target{static_cast<uint16_t>(0x200 + rng() % program_size * 2)};
+    switch (opcode & 0xF000) {
+      case 0x1000:
+      case 0x2000: {
+        opcode |= target;
+        break;
+      }
+      case 0xA000: {
+        // Data area past the program, sometimes near the end of RAM.
+        opcode |= rng() % 8 == 0 ? 0xFF8 : 0x300 + rng() % 0x100;
+        break;
+      }
+      case 0xB000: {
+        opcode |= 0x200 + rng() % 0x20;
+        break;
+      }
+      case 0x3000:
+      case 0x4000:
+      case 0x6000:
+      case 0x7000:
+      case 0xC000: {
+        opcode |= x | rng() % 0x100;
+        break;
+      }
+      case 0xD000: {
+        opcode |= x | y | rng() % 16;
+        break;
+      }
+      case 0x0000: {
+        break;
+      }
+      case 0xE000: {
+        opcode |= x;
+        break;
+      }
+      case 0xF000: {
+        opcode |= opcode == 0xF002 ? 0 : x;
+        break;
+      }
+      default: {
+        opcode |= x | y;
+        break;
+      }
+    }
+    program.push_back(static_cast<uint8_t>(opcode >> 8));
+    program.push_back(static_cast<uint8_t>(opcode));
+  }
+  return program;
+}
+
+// Random bytes filling the program area, faults and jumps anywhere included.
+std::vector<uint8_t> random_bytes(Pcg32& rng) {
+  std::vector<uint8_t> rom(program_size * 2);
+  for (auto& byte : rom) {
+    byte = static_cast<uint8_t>(rng());
+  }
+  return rom;
+}
+
+// Quirks, profiler and memory policy of a lockstep machine and the scalar
+// machines it is checked against.
+template <typename Quirks, typename Profiler, typename Memory>
+struct LockstepConfig {
+  using Machine = Lockstep<lanes, Quirks, Profiler, Memory>;
+  using Scalar = Chip8<EmptyGfx, EmptyInput, EmptyAudio, Quirks, Profiler, Memory>;
+  static constexpr bool checked{Memory::checked};
+  static constexpr bool audio{Quirks::audio_pattern};
+  static constexpr bool profiled{Profiler::enabled};
+};
+
+// Scalar machine of one lane. Faults of unchecked machines are recorded by
+// the trap and do not stop them.
+template <typename Config>
+struct ScalarLane {
+  ScalarLane() : c{gfx, input, audio} {
+    c.set_trap([this](memory::Fault /*fault*/, uint16_t /*pc*/) { faulted = true; });
+  }
+
+  EmptyGfx gfx;
+  EmptyInput input;
+  EmptyAudio audio;
+  typename Config::Scalar c;
+  bool faulted{false};
+};
+
+// Runs lockstep lanes against scalar machines on random programs.
+template <typename Config>
+class LockstepTest : public ::testing::Test {
+ public:
+  // Run rom on every lane and on a scalar machine per lane, one cycle at a
+  // time, comparing their state up to and including the first fault.
+  static void check(const std::vector<uint8_t>& rom, int program) {
+    auto lockstep{std::make_unique<typename Config::Machine>()};
+    lockstep->load(rom);
+    std::vector<std::unique_ptr<ScalarLane<Config>>> scalar;
+    for (std::size_t l = 0; l < lanes; ++l) {
+      // Lanes diverge by seed and keys.
+      auto keys{static_cast<uint16_t>(l % 3 == 0 ? 0 : 1U << l)};
+      lockstep->seed(l, l);
+      lockstep->set_keys(l, keys);
+      scalar.push_back(std::make_unique<ScalarLane<Config>>());
+      auto& lane{*scalar.back()};
+      lane.c.load(rom);
+      lane.c.seed(l);
+      lane.input.set_key_state(static_cast<int>(l), keys != 0);
+    }
+
+    for (int frame = 0; frame < 100; ++frame) {
+      for (int cycle = 0; cycle < 10; ++cycle) {
+        lockstep->run(1);
+        for (std::size_t l = 0; l < lanes; ++l) {
+          auto& lane{*scalar[l]};
+          if (lane.faulted) {
+            continue;
+          }
+          try {
+            lane.c.run(1);
+          } catch (const std::exception&) {
+            lane.faulted = true;
+          }
+          ASSERT_EQ(lockstep->faulted(l), lane.faulted) << "program " << program << " lane " << l;
+          ASSERT_EQ(lockstep->snapshot(l), lane.c.snapshot()) << "program " << program << " lane " << l;
+          if constexpr (Config::profiled) {
+            ASSERT_EQ(lockstep->profiler(l).instructions(), lane.c.profiler().instructions());
+          }
+        }
+      }
+      lockstep->update_timers();
+      for (auto& lane : scalar) {
+        lane->c.update_timers();
+      }
+    }
+  }
+};
+
+using LockstepConfigs = ::testing::Types<LockstepConfig<quirks::CosmacVip, NullProfiler, memory::Checked>,
+                                         LockstepConfig<quirks::SuperChip, NullProfiler, memory::Checked>,
+                                         LockstepConfig<quirks::XoChip, GuestProfiler, memory::Checked>,
+                                         LockstepConfig<quirks::CosmacVip, NullProfiler, memory::Unchecked>,
+                                         LockstepConfig<quirks::CosmacVip, NullProfiler, memory::CopyOnWrite>>;
+TYPED_TEST_SUITE(LockstepTest, LockstepConfigs);
+
+}  // namespace
+
+TYPED_TEST(LockstepTest, MatchesScalarCoreOnRandomPrograms) {
+  Pcg32 rng{42};
+  for (int program = 0; program < 100; ++program) {
+    this->check(random_program<TypeParam::audio>(rng), program);
+  }
+}
+
+TYPED_TEST(LockstepTest, MatchesScalarCoreOnRandomBytes) {
+  Pcg32 rng{7};
+  for (int program = 0; program < 100; ++program) {
+    this->check(random_bytes(rng), program);
+  }
+}
+
+TEST(Lockstep, LanesDivergeAndRegroup) {
+  // SKP V0, then LD V1,1 if key 0 is pressed and LD V1,2 if not, both joining at ADD V2,1.
+  Lockstep<4> lockstep;
+  lockstep.load(std::vector<uint8_t>{0xE0, 0x9E, 0x12, 0x08, 0x61, 0x01, 0x12, 0x0A, 0x61, 0x02, 0x72, 0x01});
+  lockstep.set_keys(1, 0x0001);
+  lockstep.set_keys(3, 0x0001);
+
+  // Lanes took different paths of three instructions each to ADD.
+  lockstep.run(3);
+  for (std::size_t l = 0; l < 4; ++l) {
+    ASSERT_EQ(lockstep.registers(l, 1), l % 2 == 0 ? 2 : 1);
+    ASSERT_EQ(lockstep.program_counter(l), 0x20A);
+  }
+  lockstep.run(1);
+  for (std::size_t l = 0; l < 4; ++l) {
+    ASSERT_EQ(lockstep.registers(l, 2), 1);
+    ASSERT_EQ(lockstep.program_counter(l), 0x20C);
+  }
+}
@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "chip8.h"
+#include "memory.h"
+#include "sdl.h"
+
+template <typename Memory>
+class MemoryTest : public ::testing::Test {
+ public:
+  MemoryTest() : gfx{}, in{}, audio{}, c{gfx, in, audio} {
+    c.set_trap([this](memory::Fault fault, uint16_t pc) { faults.push_back({fault, pc}); });
+  }
+
+  struct Trapped {
+    memory::Fault fault;
+    uint16_t pc;
+  };
+
+  EmptyGfx gfx;
+  EmptyInput in;
+  EmptyAudio audio;
+  Chip8<EmptyGfx, EmptyInput, EmptyAudio, quirks::CosmacVip, NullProfiler, Memory> c;
+  std::vector<Trapped> faults;
+};
+
+using CheckedTest = MemoryTest<memory::Checked>;
+using UncheckedTest = MemoryTest<memory::Unchecked>;
+using CopyOnWriteTest = MemoryTest<memory::CopyOnWrite>;
+
+TEST_F(CheckedTest, FaultsThrow) {
+  c.load({0xFF, 0xFF});
+  ASSERT_THROW(c.run(1), std::runtime_error);
+
+  // RET with an empty stack.
+  c.load({0x00, 0xEE});
+  ASSERT_THROW(c.run(1), std::out_of_range);
+
+  // LD I,addr then LD [I],Vx past the end of RAM.
+  c.load({0xAF, 0xFE, 0xF3, 0x55});
+  c.run(1);
+  ASSERT_THROW(c.run(1), std::out_of_range);
+  ASSERT_EQ(c.ram(0xFFE), 0);
+  ASSERT_TRUE(faults.empty());
+}
+
+TEST_F(CheckedTest, KeysPastLastThrow) {
+  // LD V0,0x10 then SKP V0.
+  c.load({0x60, 0x10, 0xE0, 0x9E});
+  c.run(1);
+  ASSERT_THROW(c.run(1), std::out_of_range);
+  ASSERT_EQ(c.program_counter(), 0x202);
+}
+
+TEST_F(UncheckedTest, UnknownOpcodeIsTrappedAndSkipped) {
+  c.load({0xFF, 0xFF, 0x60, 0x42});
+
+  c.run(2);
+  ASSERT_EQ(faults.size(), 1);
+  ASSERT_EQ(faults[0].fault, memory::Fault::unknown_opcode);
+  ASSERT_EQ(faults[0].pc, 0x200);
+  ASSERT_EQ(c.registers(0), 0x42);
+}
+
+TEST_F(UncheckedTest, ThrowingTrapStopsLikeChecked) {
+  c.set_trap(memory::throw_fault);
+  c.load({0xFF, 0xFF});
+  ASSERT_THROW(c.run(1), std::runtime_error);
+
+  // RET with an empty stack.
+  c.load({0x00, 0xEE});
+  ASSERT_THROW(c.run(1), std::out_of_range);
+
+  // LD I,addr then LD [I],Vx past the end of RAM.
+  c.load({0xAF, 0xFE, 0xF3, 0x55});
+  c.run(1);
+  ASSERT_THROW(c.run(1), std::out_of_range);
+}
+
+TEST_F(UncheckedTest, StackWraps) {
+  // CALL 0x200 forever.
+  c.load({0x22, 0x00});
+
+  c.run(17);
+  ASSERT_EQ(faults.size(), 1);
+  ASSERT_EQ(faults[0].fault, memory::Fault::stack_overflow);
+  ASSERT_EQ(c.stack_pointer(), 17);
+}
+
+TEST_F(UncheckedTest, AddressesWrap) {
+  // LD V0..V3, LD I,0xFFE then LD [I],V3.
+  c.load({0x60, 0x01, 0x61, 0x02, 0x62, 0x03, 0x63, 0x04, 0xAF, 0xFE, 0xF3, 0x55});
+
+  c.run(6);
+  ASSERT_EQ(faults.size(), 1);
+  ASSERT_EQ(faults[0].fault, memory::Fault::address_out_of_range);
+  ASSERT_EQ(faults[0].pc, 0x20A);
+  ASSERT_EQ(c.ram(0xFFE), 1);
+  ASSERT_EQ(c.ram(0xFFF), 2);
+  ASSERT_EQ(c.ram(0x000), 3);
+  ASSERT_EQ(c.ram(0x001), 4);
+}
+
+TEST_F(UncheckedTest, KeysWrap) {
+  // LD V0,0x10 then SKP V0, which looks up key 0.
+  in.set_key_state(0x0, true);
+  c.load({0x60, 0x10, 0xE0, 0x9E});
+
+  c.run(2);
+  ASSERT_EQ(faults.size(), 1);
+  ASSERT_EQ(faults[0].fault, memory::Fault::address_out_of_range);
+  ASSERT_EQ(faults[0].pc, 0x202);
+  ASSERT_EQ(c.program_counter(), 0x206);
+}
+
+TEST_F(UncheckedTest, ProgramCounterWraps) {
+  // JP 0xFFE, where a JP 0x200 is split across the end of RAM.
+  c.load({0x1F, 0xFF});
+  c.restore([&] {
+    auto snapshot{c.snapshot()};
+    snapshot.machine.ram[0xFFF] = 0x12;
+    snapshot.machine.ram[0x000] = 0x00;
+    return snapshot;
+  }());
+
+  c.run(2);
+  ASSERT_EQ(faults.size(), 1);
+  ASSERT_EQ(faults[0].fault, memory::Fault::address_out_of_range);
+  ASSERT_EQ(faults[0].pc, 0xFFF);
+  ASSERT_EQ(c.program_counter(), 0x200);
+}
+
+TEST_F(CopyOnWriteTest, ForksShareRamUntilWritten) {
+  // LD V0,07, LD I,0x300 then LD [I],V0.
+  c.load({0x60, 0x07, 0xA3, 0x00, 0xF0, 0x55});
+  gfx.set_pixel(1, 2, true);
+
+  EmptyGfx fork_gfx;
+  auto fork{c.fork(fork_gfx, in, audio)};
+  ASSERT_EQ(fork.snapshot(), c.snapshot());
+  ASSERT_TRUE(fork_gfx.pixel(1, 2));
+  // Fonts and code are shared.
+  auto fresh{fork.unshared_bytes()};
+  ASSERT_EQ(fresh, sizeof(fork));
+
+  fork.run(3);
+  ASSERT_EQ(fork.ram(0x300), 7);
+  ASSERT_EQ(c.ram(0x300), 0);
+  ASSERT_EQ(fork.unshared_bytes(), fresh + memory::PagedRam::page_size);
+
+  c.run(3);
+  ASSERT_EQ(c.snapshot(), fork.snapshot());
+}
+
+TEST_F(CopyOnWriteTest, ForksRunLikeCheckedMachines) {
+  // Random values stored, drawn and loaded across the boundary of two pages:
+  // RND V0,FF, RND V1,1F, LD I,0x2FE, LD B,V0, DRW V0,V1,5, LD V2,[I], JP 0x200.
+  const std::vector<uint8_t> game{0xC0, 0xFF, 0xC1, 0x1F, 0xA2, 0xFE, 0xF0, 0x33, 0xD0, 0x15, 0xF2, 0x65, 0x12, 0x00};
+  EmptyGfx checked_gfx;
+  Chip8<EmptyGfx, EmptyInput, EmptyAudio> checked{checked_gfx, in, audio};
+  checked.load(game);
+  checked.seed(5);
+  checked.run(1000);
+
+  c.load(game);
+  c.seed(5);
+  c.run(100);
+  EmptyGfx fork_gfx;
+  auto fork{c.fork(fork_gfx, in, audio)};
+  fork.set_engine(Engine::block);
+  fork.run(900);
+  c.run(900);
+  ASSERT_EQ(c.snapshot(), checked.snapshot());
+  ASSERT_EQ(fork.snapshot(), checked.snapshot());
+}
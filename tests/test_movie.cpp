@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+#include "chip8.h"
+#include "movie.h"
+#include "rom_archive.h"
+#include "sdl.h"
+
+namespace {
+
+using RecordingChip8 = Chip8<EmptyGfx, RecordingInput<EmptyInput>, EmptyAudio>;
+using ReplayChip8 = Chip8<EmptyGfx, ReplayInput, EmptyAudio>;
+
+// Waits for a key, then draws its glyph at a random position.
+const std::vector<uint8_t> key_glyphs{
+    0xF0, 0x0A,  // LD V0,K
+    0xC1, 0x3F,  // RND V1,3F
+    0xF0, 0x29,  // LD F,V0
+    0xD1, 0x25,  // DRW V1,V2,5
+    0x72, 0x01,  // ADD V2,01
+    0x12, 0x00,  // JP 0x200
+};
+
+// Record a session pressing keys 5 and A, returning the final snapshot.
+RecordingChip8::Snapshot record(Engine engine, Movie& movie) {
+  EmptyGfx gfx{};
+  EmptyInput in{};
+  EmptyAudio audio{};
+  RecordingInput<EmptyInput> recording{in, movie};
+  RecordingChip8 c{gfx, recording, audio};
+  c.set_engine(engine);
+  c.seed(movie.seed);
+  c.load(key_glyphs);
+
+  c.run(50);
+  in.set_key_state(0x5, true);
+  c.run(20);
+  in.set_key_state(0x5, false);
+  c.run(30);
+  in.set_key_state(0xA, true);
+  c.run(7);
+  in.set_key_state(0xA, false);
+  c.run(100);
+  return c.snapshot();
+}
+
+ReplayChip8::Snapshot replay(Engine engine, const Movie& movie) {
+  EmptyGfx gfx{};
+  EmptyAudio audio{};
+  ReplayInput replay{movie};
+  ReplayChip8 c{gfx, replay, audio};
+  c.set_engine(engine);
+  c.seed(movie.seed);
+  c.load(key_glyphs);
+
+  c.run(207);
+  EXPECT_TRUE(replay.finished());
+  return c.snapshot();
+}
+
+}  // namespace
+
+class MovieTest : public ::testing::TestWithParam<Engine> {};
+
+INSTANTIATE_TEST_SUITE_P(Engines, MovieTest, ::testing::Values(Engine::interpreter, Engine::block));
+
+TEST_P(MovieTest, ReplayReproducesSession) {
+  Movie movie{1234};
+  auto recorded{record(GetParam(), movie)};
+  ASSERT_EQ(movie.events.size(), 4);
+  ASSERT_EQ(recorded.machine.cycles, 207);
+  ASSERT_NE(recorded.framebuffer, ReplayChip8::Snapshot{}.framebuffer);
+
+  ASSERT_EQ(replay(Engine::interpreter, movie), recorded);
+  ASSERT_EQ(replay(Engine::block, movie), recorded);
+}
+
+TEST(MovieFile, RoundTrip) {
+  Movie movie{0x123456789ABCDEF, 0xFEDCBA987654321, "schip", 12, {{3, 0x0001}, {300, 0x8001}, {1'000'000, 0}}};
+
+  std::stringstream file;
+  movie.write(file);
+  // Header with 5-character quirk profile, then deltas of 1, 2 and 3 bytes,
+  // each with a 2-byte mask.
+  ASSERT_EQ(file.str().size(), 16 + 8 + 4 + 1 + 5 + 3 + 4 + 5);
+  ASSERT_EQ(Movie::read(file), movie);
+
+  std::stringstream truncated{file.str().substr(0, file.str().size() - 1)};
+  ASSERT_THROW(Movie::read(truncated), std::runtime_error);
+
+  std::stringstream not_movie{"not a movie, definitely not a movie"};
+  ASSERT_THROW(Movie::read(not_movie), std::runtime_error);
+}
+
+TEST(MovieFile, RejectsOtherSession) {
+  const std::vector<uint8_t> rom{0x12, 0x00};
+  Movie movie{1234, fnv1a(rom), "vip", 10, {}};
+  ASSERT_NO_THROW(movie.check(fnv1a(rom), "vip", 10));
+
+  const std::vector<uint8_t> other_rom{0x12, 0x02};
+  ASSERT_THROW(movie.check(fnv1a(other_rom), "vip", 10), std::runtime_error);
+  ASSERT_THROW(movie.check(fnv1a(rom), "xochip", 10), std::runtime_error);
+  ASSERT_THROW(movie.check(fnv1a(rom), "vip", 20), std::runtime_error);
+}
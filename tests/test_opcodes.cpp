@@ -1,495 +1,678 @@
 #include <gtest/gtest.h>
 
 #include "chip8.h"
+#include "memory.h"
 #include "sdl.h"
 
-using MockedChip8 = Chip8<EmptyGfx, EmptyInput, EmptyAudio>;
+// Engine and memory policy an opcode test runs with. Forked machines are
+// forks of a fresh copy-on-write machine, sharing its RAM pages.
+template <Engine E, typename Memory, bool Forked>
+struct OpCodeConfig {
+  static constexpr Engine engine{E};
+  static constexpr bool forked{Forked};
+  using Machine = Chip8<EmptyGfx, EmptyInput, EmptyAudio, quirks::CosmacVip, NullProfiler, Memory>;
+};
 
+// Runs every opcode test with each execution engine, on new and on forked machines.
+template <typename Config>
 class OpCodeTest : public ::testing::Test {
  public:
-  OpCodeTest() : gfx{}, in{}, audio{}, c{MockedChip8{gfx, in, audio}} {}
+  using Machine = typename Config::Machine;
+
+  OpCodeTest() : gfx{}, in{}, audio{}, parent_gfx{}, parent{parent_gfx, in, audio}, c{make()} {}
+
+  // New machine, forked if the test runs on forks.
+  Machine make() {
+    Machine machine{Config::forked ? parent.fork(gfx, in, audio) : Machine{gfx, in, audio}};
+    machine.set_engine(Config::engine);
+    return machine;
+  }
+
+  // Start over on a new machine.
+  void reset() { c = make(); }
 
   EmptyGfx gfx;
   EmptyInput in;
   EmptyAudio audio;
-  MockedChip8 c;
+  EmptyGfx parent_gfx;
+  Machine parent;
+  Machine c;
 };
 
-TEST_F(OpCodeTest, CLS_00E0) {
-  gfx.set_pixel(10, 10, true);
+using OpCodeConfigs = ::testing::Types<OpCodeConfig<Engine::interpreter, memory::Checked, false>,
+                                       OpCodeConfig<Engine::block, memory::Checked, false>,
+                                       OpCodeConfig<Engine::interpreter, memory::CopyOnWrite, true>,
+                                       OpCodeConfig<Engine::block, memory::CopyOnWrite, true>>;
+TYPED_TEST_SUITE(OpCodeTest, OpCodeConfigs);
 
-  c.load({0x00, 0xE0});
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x202);
-  ASSERT_EQ(gfx.pixel(10, 10), false);
+TYPED_TEST(OpCodeTest, CLS_00E0) {
+  this->gfx.set_pixel(10, 10, true);
+
+  this->c.load({0x00, 0xE0});
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x202);
+  ASSERT_EQ(this->gfx.pixel(10, 10), false);
 }
 
-TEST_F(OpCodeTest, CALL_2xxx_RET_00EE) {
+TYPED_TEST(OpCodeTest, CALL_2xxx_RET_00EE) {
   std::vector<uint8_t> p(0xF, 0);
   p[0x0] = 0x22;
   p[0x1] = 0x06;
   p[0x6] = 0x00;
   p[0x7] = 0xEE;
 
-  c.load(p);
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x206);
-  ASSERT_EQ(c.stack_pointer(), 1);
-  ASSERT_EQ(c.stack(0), 0x0200);
+  this->c.load(p);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x206);
+  ASSERT_EQ(this->c.stack_pointer(), 1);
+  ASSERT_EQ(this->c.stack(0), 0x0200);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x202);
-  ASSERT_EQ(c.stack_pointer(), 0);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x202);
+  ASSERT_EQ(this->c.stack_pointer(), 0);
 }
 
-TEST_F(OpCodeTest, JMP_1xxx) {
-  c.load({0x1A, 0xBC});
-  c.execute_cycle();
+TYPED_TEST(OpCodeTest, JMP_1xxx) {
+  this->c.load({0x1A, 0xBC});
+  this->c.run(1);
 
-  ASSERT_EQ(c.program_counter(), 0x0ABC);
+  ASSERT_EQ(this->c.program_counter(), 0x0ABC);
 }
 
-TEST_F(OpCodeTest, SEVxNN_3xnn) {
+TYPED_TEST(OpCodeTest, SEVxNN_3xnn) {
   // LD VX,NN then SE Vx,NN
   // PC += 4
-  c.load({0x65, 0xAB, 0x35, 0xAB});
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x202);
-  ASSERT_EQ(c.registers(0x5), 0xAB);
+  this->c.load({0x65, 0xAB, 0x35, 0xAB});
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x202);
+  ASSERT_EQ(this->c.registers(0x5), 0xAB);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x206);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x206);
 
   // PC += 2
-  c = MockedChip8(gfx, in, audio);
-  c.load({0x65, 0xAB, 0x35, 0xFF});
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x202);
-  ASSERT_EQ(c.registers(0x5), 0xAB);
+  this->reset();
+  this->c.load({0x65, 0xAB, 0x35, 0xFF});
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x202);
+  ASSERT_EQ(this->c.registers(0x5), 0xAB);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x204);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x204);
 }
 
-TEST_F(OpCodeTest, SNEVxNN_4xnn) {
+TYPED_TEST(OpCodeTest, SNEVxNN_4xnn) {
   // LD VX,NN then SNE Vx,NN
   // PC += 2
-  c.load({0x65, 0xAB, 0x45, 0xAB});
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x202);
-  ASSERT_EQ(c.registers(0x5), 0xAB);
+  this->c.load({0x65, 0xAB, 0x45, 0xAB});
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x202);
+  ASSERT_EQ(this->c.registers(0x5), 0xAB);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x204);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x204);
 
   // PC += 4
-  c = MockedChip8(gfx, in, audio);
-  c.load({0x65, 0xAB, 0x45, 0xFF});
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x202);
-  ASSERT_EQ(c.registers(0x5), 0xAB);
+  this->reset();
+  this->c.load({0x65, 0xAB, 0x45, 0xFF});
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x202);
+  ASSERT_EQ(this->c.registers(0x5), 0xAB);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x206);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x206);
 }
 
-TEST_F(OpCodeTest, SEVxVy_5xy0) {
+TYPED_TEST(OpCodeTest, SEVxVy_5xy0) {
   // LD Vy,NN then LD Vy,NN then SE Vx,Vy
   // PC += 4
-  c.load({0x65, 0xAB, 0x67, 0xAB, 0x55, 0x70});
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x202);
-  ASSERT_EQ(c.registers(0x5), 0xAB);
+  this->c.load({0x65, 0xAB, 0x67, 0xAB, 0x55, 0x70});
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x202);
+  ASSERT_EQ(this->c.registers(0x5), 0xAB);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x204);
-  ASSERT_EQ(c.registers(0x7), 0xAB);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x204);
+  ASSERT_EQ(this->c.registers(0x7), 0xAB);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x208);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x208);
 
   // PC += 2
-  c = MockedChip8(gfx, in, audio);
-  c.load({0x65, 0xAB, 0x67, 0xFF, 0x55, 0x70});
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x202);
-  ASSERT_EQ(c.registers(0x5), 0xAB);
+  this->reset();
+  this->c.load({0x65, 0xAB, 0x67, 0xFF, 0x55, 0x70});
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x202);
+  ASSERT_EQ(this->c.registers(0x5), 0xAB);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x204);
-  ASSERT_EQ(c.registers(0x7), 0xFF);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x204);
+  ASSERT_EQ(this->c.registers(0x7), 0xFF);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x206);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x206);
 }
 
-TEST_F(OpCodeTest, LDVxNN_6xnn) {
-  c.load({0x65, 0xAB});
+TYPED_TEST(OpCodeTest, LDVxNN_6xnn) {
+  this->c.load({0x65, 0xAB});
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x202);
-  ASSERT_EQ(c.registers(0x5), 0xAB);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x202);
+  ASSERT_EQ(this->c.registers(0x5), 0xAB);
 }
 
-TEST_F(OpCodeTest, ADDVxNN_7xkk) {
+TYPED_TEST(OpCodeTest, ADDVxNN_7xkk) {
   // LD Vx,NN then ADD Vx,NN
-  c.load({0x6D, 0x10, 0x7D, 0x20});
+  this->c.load({0x6D, 0x10, 0x7D, 0x20});
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x202);
-  ASSERT_EQ(c.registers(0xD), 0x10);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x202);
+  ASSERT_EQ(this->c.registers(0xD), 0x10);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x204);
-  ASSERT_EQ(c.registers(0xD), 0x10 + 0x20);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x204);
+  ASSERT_EQ(this->c.registers(0xD), 0x10 + 0x20);
 }
 
-TEST_F(OpCodeTest, LDVxVy_8xy0) {
+TYPED_TEST(OpCodeTest, LDVxVy_8xy0) {
   // LD Vy,NN then LD Vx,Vy
-  c.load({0x6D, 0xAB, 0x85, 0xD0});
+  this->c.load({0x6D, 0xAB, 0x85, 0xD0});
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x202);
-  ASSERT_EQ(c.registers(0xD), 0xAB);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x202);
+  ASSERT_EQ(this->c.registers(0xD), 0xAB);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x204);
-  ASSERT_EQ(c.registers(0x5), 0xAB);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x204);
+  ASSERT_EQ(this->c.registers(0x5), 0xAB);
 }
 
-TEST_F(OpCodeTest, ORVxVy_8xy1) {
+TYPED_TEST(OpCodeTest, ORVxVy_8xy1) {
   // LD Vx,NN then LD Vy,NN then OR Vx,Vy
-  c.load({0x6D, 0xAB, 0x63, 0xCD, 0x8D, 0x31});
+  this->c.load({0x6D, 0xAB, 0x63, 0xCD, 0x8D, 0x31});
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x202);
-  ASSERT_EQ(c.registers(0xD), 0xAB);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x202);
+  ASSERT_EQ(this->c.registers(0xD), 0xAB);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x204);
-  ASSERT_EQ(c.registers(0x3), 0xCD);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x204);
+  ASSERT_EQ(this->c.registers(0x3), 0xCD);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x206);
-  ASSERT_EQ(c.registers(0xD), 0xAB | 0xCD);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x206);
+  ASSERT_EQ(this->c.registers(0xD), 0xAB | 0xCD);
 }
 
-TEST_F(OpCodeTest, ANDVxVy_8xy2) {
+TYPED_TEST(OpCodeTest, ANDVxVy_8xy2) {
   // LD Vx,NN then LD Vy,NN then AND Vx,Vy
-  c.load({0x6D, 0xAB, 0x63, 0xCD, 0x8D, 0x32});
+  this->c.load({0x6D, 0xAB, 0x63, 0xCD, 0x8D, 0x32});
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x202);
-  ASSERT_EQ(c.registers(0xD), 0xAB);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x202);
+  ASSERT_EQ(this->c.registers(0xD), 0xAB);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x204);
-  ASSERT_EQ(c.registers(0x3), 0xCD);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x204);
+  ASSERT_EQ(this->c.registers(0x3), 0xCD);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x206);
-  ASSERT_EQ(c.registers(0xD), 0xAB & 0xCD);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x206);
+  ASSERT_EQ(this->c.registers(0xD), 0xAB & 0xCD);
 }
 
-TEST_F(OpCodeTest, XORVxVy_8xy3) {
+TYPED_TEST(OpCodeTest, XORVxVy_8xy3) {
   // LD Vx,NN then LD Vy,NN then XOR Vx,Vy
-  c.load({0x6D, 0xAB, 0x63, 0xCD, 0x8D, 0x33});
+  this->c.load({0x6D, 0xAB, 0x63, 0xCD, 0x8D, 0x33});
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x202);
-  ASSERT_EQ(c.registers(0xD), 0xAB);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x202);
+  ASSERT_EQ(this->c.registers(0xD), 0xAB);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x204);
-  ASSERT_EQ(c.registers(0x3), 0xCD);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x204);
+  ASSERT_EQ(this->c.registers(0x3), 0xCD);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x206);
-  ASSERT_EQ(c.registers(0xD), 0xAB ^ 0xCD);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x206);
+  ASSERT_EQ(this->c.registers(0xD), 0xAB ^ 0xCD);
 }
 
-TEST_F(OpCodeTest, ADDVxVy_8xy4) {
+TYPED_TEST(OpCodeTest, ADDVxVy_8xy4) {
   // LD Vx,NN then LD Vy,NN then ADD Vx,Vy
-  c.load({0x6D, 0xDD, 0x63, 0xFE, 0x8D, 0x34});
+  this->c.load({0x6D, 0xDD, 0x63, 0xFE, 0x8D, 0x34});
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x202);
-  ASSERT_EQ(c.registers(0xD), 0xDD);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x202);
+  ASSERT_EQ(this->c.registers(0xD), 0xDD);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x204);
-  ASSERT_EQ(c.registers(0x3), 0xFE);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x204);
+  ASSERT_EQ(this->c.registers(0x3), 0xFE);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x206);
-  ASSERT_EQ(c.registers(0xD), static_cast<uint8_t>(0xDD + 0xFE));
-  ASSERT_EQ(c.registers(0xF), 1);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x206);
+  ASSERT_EQ(this->c.registers(0xD), static_cast<uint8_t>(0xDD + 0xFE));
+  ASSERT_EQ(this->c.registers(0xF), 1);
 }
 
-TEST_F(OpCodeTest, SUBVxVy_8xy5) {
+TYPED_TEST(OpCodeTest, SUBVxVy_8xy5) {
   // LD Vx,NN then LD Vy,NN then SUB Vx,Vy
-  c.load({0x6D, 0xDD, 0x63, 0xFE, 0x8D, 0x35});
+  this->c.load({0x6D, 0xDD, 0x63, 0xFE, 0x8D, 0x35});
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x202);
-  ASSERT_EQ(c.registers(0xD), 0xDD);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x202);
+  ASSERT_EQ(this->c.registers(0xD), 0xDD);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x204);
-  ASSERT_EQ(c.registers(0x3), 0xFE);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x204);
+  ASSERT_EQ(this->c.registers(0x3), 0xFE);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x206);
-  ASSERT_EQ(c.registers(0xD), static_cast<uint8_t>(0xDD - 0xFE));
-  ASSERT_EQ(c.registers(0xF), 0);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x206);
+  ASSERT_EQ(this->c.registers(0xD), static_cast<uint8_t>(0xDD - 0xFE));
+  ASSERT_EQ(this->c.registers(0xF), 0);
 }
 
-TEST_F(OpCodeTest, DISABLED_SHRVxVy_8xy6) {
-  // Disabled for now - other implementation for SHR is used.
-  // LD Vx,NN then SHR Vx,[Vy]
-  c.load({0x6D, 0xFB, 0x8D, 0x06});
+TYPED_TEST(OpCodeTest, SHRVxVy_8xy6) {
+  // LD Vy,NN then SHR Vx,[Vy]
+  this->c.load({0x6D, 0xFB, 0x85, 0xD6});
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x202);
-  ASSERT_EQ(c.registers(0xD), 0xFB);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x202);
+  ASSERT_EQ(this->c.registers(0xD), 0xFB);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x204);
-  ASSERT_EQ(c.registers(0xD), 0xFB >> 1);
-  ASSERT_EQ(c.registers(0xF), 1);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x204);
+  ASSERT_EQ(this->c.registers(0x5), 0xFB >> 1);
+  ASSERT_EQ(this->c.registers(0xF), 1);
 }
 
-TEST_F(OpCodeTest, SUBNVxVy_8xy7) {
+TYPED_TEST(OpCodeTest, SUBNVxVy_8xy7) {
   // LD Vx,NN then LD Vy,NN then SUBN Vx,Vy
-  c.load({0x6D, 0xDD, 0x63, 0xFE, 0x8D, 0x37});
+  this->c.load({0x6D, 0xDD, 0x63, 0xFE, 0x8D, 0x37});
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x202);
-  ASSERT_EQ(c.registers(0xD), 0xDD);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x202);
+  ASSERT_EQ(this->c.registers(0xD), 0xDD);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x204);
-  ASSERT_EQ(c.registers(0x3), 0xFE);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x204);
+  ASSERT_EQ(this->c.registers(0x3), 0xFE);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x206);
-  ASSERT_EQ(c.registers(0xD), static_cast<uint8_t>(0xFE - 0xDD));
-  ASSERT_EQ(c.registers(0xF), 1);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x206);
+  ASSERT_EQ(this->c.registers(0xD), static_cast<uint8_t>(0xFE - 0xDD));
+  ASSERT_EQ(this->c.registers(0xF), 1);
 }
 
-TEST_F(OpCodeTest, DISABLED_SHLVxVy_8xyE) {
-  // Disabled for now - other implementation for SHL is used.
-  // LD Vx,NN then SHL Vx,[Vy]
-  c.load({0x6D, 0xCB, 0x8D, 0x0E});
+TYPED_TEST(OpCodeTest, SHLVxVy_8xyE) {
+  // LD Vy,NN then SHL Vx,[Vy]
+  this->c.load({0x6D, 0xCB, 0x85, 0xDE});
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x202);
-  ASSERT_EQ(c.registers(0xD), 0xCB);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x202);
+  ASSERT_EQ(this->c.registers(0xD), 0xCB);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x204);
-  ASSERT_EQ(c.registers(0xD), static_cast<uint8_t>(0xCB << 1));
-  ASSERT_EQ(c.registers(0xF), 1);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x204);
+  ASSERT_EQ(this->c.registers(0x5), static_cast<uint8_t>(0xCB << 1));
+  ASSERT_EQ(this->c.registers(0xF), 1);
 }
 
-TEST_F(OpCodeTest, SNEVxVy_9xy0) {
+TYPED_TEST(OpCodeTest, SNEVxVy_9xy0) {
   // LD Vy,NN then LD Vy,NN then SNE Vx,Vy
   // PC += 2
-  c.load({0x65, 0xAB, 0x67, 0xAB, 0x95, 0x70});
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x202);
-  ASSERT_EQ(c.registers(0x5), 0xAB);
+  this->c.load({0x65, 0xAB, 0x67, 0xAB, 0x95, 0x70});
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x202);
+  ASSERT_EQ(this->c.registers(0x5), 0xAB);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x204);
-  ASSERT_EQ(c.registers(0x7), 0xAB);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x204);
+  ASSERT_EQ(this->c.registers(0x7), 0xAB);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x206);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x206);
 
   // PC += 4
-  c = MockedChip8(gfx, in, audio);
-  c.load({0x65, 0xAB, 0x67, 0xFF, 0x95, 0x70});
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x202);
-  ASSERT_EQ(c.registers(0x5), 0xAB);
+  this->reset();
+  this->c.load({0x65, 0xAB, 0x67, 0xFF, 0x95, 0x70});
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x202);
+  ASSERT_EQ(this->c.registers(0x5), 0xAB);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x204);
-  ASSERT_EQ(c.registers(0x7), 0xFF);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x204);
+  ASSERT_EQ(this->c.registers(0x7), 0xFF);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x208);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x208);
 }
 
-TEST_F(OpCodeTest, LDIaddr_Annn) {
-  c.load({0xAC, 0xDE});
+TYPED_TEST(OpCodeTest, LDIaddr_Annn) {
+  this->c.load({0xAC, 0xDE});
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x202);
-  ASSERT_EQ(c.index_register(), 0xCDE);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x202);
+  ASSERT_EQ(this->c.index_register(), 0xCDE);
 }
 
-TEST_F(OpCodeTest, JPV0addr_Bnnn) {
+TYPED_TEST(OpCodeTest, JPV0addr_Bnnn) {
   // LD Vx,NN then JP V0,addr
-  c.load({0x60, 0xAA, 0xBB, 0x88});
-
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x202);
-  ASSERT_EQ(c.registers(0), 0xAA);
-
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0xB88 + 0xAA);
-}
-
-TEST_F(OpCodeTest, DISABLED_RNDVxNN_Cxnn) {
-  // TODO: testing random
-}
-
-TEST_F(OpCodeTest, DISABLED_DRWVxVyn_Dxyn) {
-  // TODO: testing graphics
-}
-
-TEST_F(OpCodeTest, SKP_Ex9E) {
+  this->c.load({0x60, 0xAA, 0xBB, 0x88});
+
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x202);
+  ASSERT_EQ(this->c.registers(0), 0xAA);
+
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0xB88 + 0xAA);
+}
+
+TYPED_TEST(OpCodeTest, RNDVxNN_Cxnn) {
+  // RND V0,FF then RND V1,0F then RND V2,00.
+  const std::vector<uint8_t> p{0xC0, 0xFF, 0xC1, 0x0F, 0xC2, 0x00};
+  this->c.seed(1234);
+  this->c.load(p);
+  this->c.run(3);
+  ASSERT_EQ(this->c.program_counter(), 0x206);
+  ASSERT_EQ(this->c.registers(1) & 0xF0, 0);
+  ASSERT_EQ(this->c.registers(2), 0);
+
+  // Same seed, same values.
+  auto other{this->make()};
+  other.seed(1234);
+  other.load(p);
+  other.run(3);
+  ASSERT_EQ(other.registers(0), this->c.registers(0));
+  ASSERT_EQ(other.registers(1), this->c.registers(1));
+}
+
+TYPED_TEST(OpCodeTest, DRWVxVyn_Dxyn) {
+  // LD I,addr then LD Vx,NN then LD Vy,NN then DRW Vx,Vy,n twice.
+  // Draws font glyph "0" at (2, 3), then erases it.
+  this->c.load({0xA0, 0x00, 0x61, 0x02, 0x62, 0x03, 0xD1, 0x25, 0xD1, 0x25});
+
+  this->c.run(1);
+  this->c.run(1);
+  this->c.run(1);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x208);
+  ASSERT_EQ(this->c.registers(0xF), 0);
+  ASSERT_EQ(this->gfx.pixel(2, 3), true);
+  ASSERT_EQ(this->gfx.pixel(5, 3), true);
+  ASSERT_EQ(this->gfx.pixel(3, 4), false);
+  ASSERT_EQ(this->gfx.pixel(2, 7), true);
+  ASSERT_EQ(this->gfx.pixel(6, 3), false);
+
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x20A);
+  ASSERT_EQ(this->c.registers(0xF), 1);
+  ASSERT_EQ(this->gfx.pixel(2, 3), false);
+  ASSERT_EQ(this->gfx.pixel(2, 7), false);
+}
+
+TYPED_TEST(OpCodeTest, SKP_Ex9E) {
   // LD Vx, NN then SKP Vx
   // Key pressed.
-  in.set_key_state(0xA, true);
-  c.load({0x65, 0x0A, 0xE5, 0x9E});
+  this->in.set_key_state(0xA, true);
+  this->c.load({0x65, 0x0A, 0xE5, 0x9E});
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x202);
-  ASSERT_EQ(c.registers(0x5), 0x0A);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x202);
+  ASSERT_EQ(this->c.registers(0x5), 0x0A);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x206);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x206);
 
   // Key not pressed.
-  in.set_key_state(0xA, false);
-  c = MockedChip8(gfx, in, audio);
-  c.load({0x65, 0x0A, 0xE5, 0x9E});
+  this->in.set_key_state(0xA, false);
+  this->reset();
+  this->c.load({0x65, 0x0A, 0xE5, 0x9E});
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x202);
-  ASSERT_EQ(c.registers(0x5), 0x0A);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x202);
+  ASSERT_EQ(this->c.registers(0x5), 0x0A);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x204);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x204);
 }
 
-TEST_F(OpCodeTest, SKPN_ExA1) {
+TYPED_TEST(OpCodeTest, SKPN_ExA1) {
   // LD Vx, NN then SKP Vx
   // Key pressed.
-  in.set_key_state(0xA, true);
-  c.load({0x65, 0x0A, 0xE5, 0xA1});
+  this->in.set_key_state(0xA, true);
+  this->c.load({0x65, 0x0A, 0xE5, 0xA1});
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x202);
-  ASSERT_EQ(c.registers(0x5), 0x0A);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x202);
+  ASSERT_EQ(this->c.registers(0x5), 0x0A);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x204);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x204);
 
   // Key not pressed.
-  in.set_key_state(0xA, false);
-  c = MockedChip8(gfx, in, audio);
-  c.load({0x65, 0x0A, 0xE5, 0xA1});
+  this->in.set_key_state(0xA, false);
+  this->reset();
+  this->c.load({0x65, 0x0A, 0xE5, 0xA1});
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x202);
-  ASSERT_EQ(c.registers(0x5), 0x0A);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x202);
+  ASSERT_EQ(this->c.registers(0x5), 0x0A);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x206);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x206);
 }
 
-TEST_F(OpCodeTest, LDVxDT_Fx07) {
+TYPED_TEST(OpCodeTest, LDVxDT_Fx07) {
   // LD Vx,NN then LD DT,Vx then LD Vx,DT
-  c.load({0x65, 0xCC, 0xF5, 0x15, 0xF3, 0x07});
+  this->c.load({0x65, 0xCC, 0xF5, 0x15, 0xF3, 0x07});
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x202);
-  ASSERT_EQ(c.registers(0x5), 0xCC);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x202);
+  ASSERT_EQ(this->c.registers(0x5), 0xCC);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x204);
-  ASSERT_EQ(c.delay_timer(), 0xCC);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x204);
+  ASSERT_EQ(this->c.delay_timer(), 0xCC);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x206);
-  ASSERT_EQ(c.registers(0x3), 0xCC);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x206);
+  ASSERT_EQ(this->c.registers(0x3), 0xCC);
 }
 
-TEST_F(OpCodeTest, LDVxK_Fx0A) {
-  c.load({0xFC, 0x0A});
+TYPED_TEST(OpCodeTest, LDVxK_Fx0A) {
+  this->c.load({0xFC, 0x0A});
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x200);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x200);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x200);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x200);
 
-  in.set_key_state(0xD, true);
-  in.set_key_state(0xA, true);
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x202);
-  ASSERT_EQ(c.registers(0xC), 0xA);
+  this->in.set_key_state(0xD, true);
+  this->in.set_key_state(0xA, true);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x202);
+  ASSERT_EQ(this->c.registers(0xC), 0xA);
 }
 
-TEST_F(OpCodeTest, LDDTVx_Fx15) {
+TYPED_TEST(OpCodeTest, LDDTVx_Fx15) {
   // LD Vx,NN then LD DT,Vx
-  c.load({0x65, 0xCC, 0xF5, 0x15});
+  this->c.load({0x65, 0xCC, 0xF5, 0x15});
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x202);
-  ASSERT_EQ(c.registers(0x5), 0xCC);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x202);
+  ASSERT_EQ(this->c.registers(0x5), 0xCC);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x204);
-  ASSERT_EQ(c.delay_timer(), 0xCC);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x204);
+  ASSERT_EQ(this->c.delay_timer(), 0xCC);
 }
 
-TEST_F(OpCodeTest, LDSTVx_Fx18) {
+TYPED_TEST(OpCodeTest, LDSTVx_Fx18) {
   // LD Vx,NN then LD ST,Vx
-  c.load({0x65, 0xCC, 0xF5, 0x18});
+  this->c.load({0x65, 0xCC, 0xF5, 0x18});
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x202);
-  ASSERT_EQ(c.registers(0x5), 0xCC);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x202);
+  ASSERT_EQ(this->c.registers(0x5), 0xCC);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x204);
-  ASSERT_EQ(c.sound_timer(), 0xCC);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x204);
+  ASSERT_EQ(this->c.sound_timer(), 0xCC);
 }
 
-TEST_F(OpCodeTest, ADDIVx_Fx1E) {
+TYPED_TEST(OpCodeTest, ADDIVx_Fx1E) {
   // LD I,addr then LD Vx,NN then ADD I,Vx
-  c.load({0xAC, 0xDE, 0x65, 0xFE, 0xF5, 0x1E});
+  this->c.load({0xAC, 0xDE, 0x65, 0xFE, 0xF5, 0x1E});
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x202);
-  ASSERT_EQ(c.index_register(), 0xCDE);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x202);
+  ASSERT_EQ(this->c.index_register(), 0xCDE);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x204);
-  ASSERT_EQ(c.registers(0x5), 0xFE);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x204);
+  ASSERT_EQ(this->c.registers(0x5), 0xFE);
 
-  c.execute_cycle();
-  ASSERT_EQ(c.program_counter(), 0x206);
-  ASSERT_EQ(c.index_register(), 0xCDE + 0xFE);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x206);
+  ASSERT_EQ(this->c.index_register(), 0xCDE + 0xFE);
 }
 
-TEST_F(OpCodeTest, DISABLED_LDFVx_Fx29) {
-  // TODO
-}
+TYPED_TEST(OpCodeTest, LDFVx_Fx29) {
+  // LD Vx,NN then LD F,Vx
+  this->c.load({0x65, 0x0B, 0xF5, 0x29});
 
-TEST_F(OpCodeTest, DISABLED_LDBVx_Fx33) {
-  // TODO
+  this->c.run(1);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x204);
+  ASSERT_EQ(this->c.index_register(), 0xB * 5);
 }
 
-TEST_F(OpCodeTest, DISABLED_LDIVx_Fx55) {
-  // TODO
-}
+TYPED_TEST(OpCodeTest, LDBVx_Fx33) {
+  // LD I,addr then LD Vx,NN then LD B,Vx
+  this->c.load({0xA3, 0x00, 0x65, 0xFE, 0xF5, 0x33});
 
-TEST_F(OpCodeTest, DISABLED_LDVxI_Fx65) {
-  // TODO
+  this->c.run(1);
+  this->c.run(1);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x206);
+  ASSERT_EQ(this->c.ram(0x300), 2);
+  ASSERT_EQ(this->c.ram(0x301), 5);
+  ASSERT_EQ(this->c.ram(0x302), 4);
+}
+
+TYPED_TEST(OpCodeTest, LDIVx_Fx55) {
+  // LD I,addr then LD V0,NN then LD V1,NN then LD [I],Vx
+  this->c.load({0xA3, 0x00, 0x60, 0xAB, 0x61, 0xCD, 0xF1, 0x55});
+
+  for (int i = 0; i < 4; ++i) {
+    this->c.run(1);
+  }
+  ASSERT_EQ(this->c.program_counter(), 0x208);
+  ASSERT_EQ(this->c.ram(0x300), 0xAB);
+  ASSERT_EQ(this->c.ram(0x301), 0xCD);
+  ASSERT_EQ(this->c.ram(0x302), 0);
+  ASSERT_EQ(this->c.index_register(), 0x302);
+}
+
+TYPED_TEST(OpCodeTest, LDVxI_Fx65) {
+  // LD I,addr then LD Vx,[I], reading the program itself.
+  this->c.load({0xA2, 0x00, 0xF1, 0x65});
+
+  this->c.run(1);
+  this->c.run(1);
+  ASSERT_EQ(this->c.program_counter(), 0x204);
+  ASSERT_EQ(this->c.registers(0x0), 0xA2);
+  ASSERT_EQ(this->c.registers(0x1), 0x00);
+  ASSERT_EQ(this->c.registers(0x2), 0);
+  ASSERT_EQ(this->c.index_register(), 0x202);
+}
+
+TYPED_TEST(OpCodeTest, SelfModifyingCode) {
+  // LD V2,01 is executed, then overwritten with LD V2,07 by LD [I],Vx and executed again.
+  this->c.load({0x62, 0x01, 0xA2, 0x00, 0x60, 0x62, 0x61, 0x07, 0xF1, 0x55, 0x12, 0x00});
+
+  this->c.run(1);
+  ASSERT_EQ(this->c.registers(0x2), 0x01);
+
+  for (int i = 0; i < 5; ++i) {
+    this->c.run(1);
+  }
+  ASSERT_EQ(this->c.program_counter(), 0x200);
+
+  this->c.run(1);
+  ASSERT_EQ(this->c.registers(0x2), 0x07);
+}
+
+TYPED_TEST(OpCodeTest, LDIVxOverwritingItself) {
+  // LD I,addr then LD [I],Vx storing V0..V3 over itself, still incrementing I by 4.
+  this->c.load({0xA2, 0x02, 0xF3, 0x55});
+
+  this->c.run(2);
+  ASSERT_EQ(this->c.program_counter(), 0x204);
+  ASSERT_EQ(this->c.index_register(), 0x206);
+  ASSERT_EQ(this->c.ram(0x202), 0);
+}
+
+TYPED_TEST(OpCodeTest, LDBVxOverwritingItself) {
+  // LD V5,123, LD I,addr, then LD B,V5 storing digits over itself, still reading V5 for every digit.
+  this->c.load({0x65, 0x7B, 0xA2, 0x04, 0xF5, 0x33});
+
+  this->c.run(3);
+  ASSERT_EQ(this->c.program_counter(), 0x206);
+  ASSERT_EQ(this->c.ram(0x204), 1);
+  ASSERT_EQ(this->c.ram(0x205), 2);
+  ASSERT_EQ(this->c.ram(0x206), 3);
+}
+
+TYPED_TEST(OpCodeTest, RunsManyCycles) {
+  // Count V0 up to 0x40 in a loop, then spin on a jump to self.
+  this->c.load({0x70, 0x01, 0x30, 0x40, 0x12, 0x00, 0x12, 0x06});
+
+  this->c.run(0x40 * 3 + 5);
+  ASSERT_EQ(this->c.registers(0x0), 0x40);
+  ASSERT_EQ(this->c.program_counter(), 0x206);
+}
+
+TYPED_TEST(OpCodeTest, SkipsIdleLoopsWithoutChangingState) {
+  const std::vector<uint8_t> waits{
+      0x60, 0x05,  // LD V0,05
+      0xF0, 0x15,  // LD DT,V0
+      0xF1, 0x07,  // LD V1,DT
+      0x31, 0x00,  // SE V1,00
+      0x12, 0x04,  // JP 0x204
+      0xF2, 0x0A,  // LD V2,K
+      0x60, 0x03,  // LD V0,03
+      0xF0, 0x15,  // LD DT,V0
+      0xF4, 0x07,  // LD V4,DT
+      0x44, 0x03,  // SNE V4,03
+      0x12, 0x10,  // JP 0x210
+      0x12, 0x16,  // JP 0x216
+  };
+
+  for (std::size_t cycles_per_frame : {1, 2, 3, 10, 31}) {
+    this->reset();
+    auto reference{this->make()};
+    reference.set_idle_skip(false);
+    this->c.load(waits);
+    reference.load(waits);
+
+    for (int frame = 0; frame < 30; ++frame) {
+      this->in.set_key_state(0x7, frame == 20);
+      if (frame == 19) {
+        ASSERT_TRUE(this->c.waiting_for_input());
+      }
+      this->c.step_frame(cycles_per_frame);
+      reference.step_frame(cycles_per_frame);
+      ASSERT_EQ(this->c.snapshot(), reference.snapshot());
+    }
+    ASSERT_EQ(this->c.registers(0x2), 0x07);
+    ASSERT_EQ(this->c.program_counter(), 0x216);
+    ASSERT_TRUE(this->c.waiting_for_input());
+    ASSERT_GT(this->c.skipped_cycles(), 0);
+    ASSERT_EQ(reference.skipped_cycles(), 0);
+  }
 }
@@ -0,0 +1,47 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+#include "chip8.h"
+#include "profiler.h"
+#include "sdl.h"
+
+using ProfiledChip8 = Chip8<EmptyGfx, EmptyInput, EmptyAudio, quirks::CosmacVip, GuestProfiler>;
+
+class ProfilerTest : public ::testing::Test {
+ public:
+  ProfilerTest() : gfx{}, in{}, audio{}, c{gfx, in, audio} {
+    // CALL 0x206 twice, then spin. Subroutine: ADD V0,01 then RET.
+    c.load({0x22, 0x06, 0x22, 0x06, 0x12, 0x04, 0x70, 0x01, 0x00, 0xEE});
+    c.run(9);
+  }
+
+  EmptyGfx gfx;
+  EmptyInput in;
+  EmptyAudio audio;
+  ProfiledChip8 c;
+};
+
+TEST_F(ProfilerTest, CountsOpcodesAndAddresses) {
+  const auto& profiler{c.profiler()};
+  ASSERT_EQ(profiler.instructions(), 9);
+  ASSERT_EQ(profiler.opcode_count("2NNN"), 2);
+  ASSERT_EQ(profiler.opcode_count("7XNN"), 2);
+  ASSERT_EQ(profiler.opcode_count("00EE"), 2);
+  ASSERT_EQ(profiler.opcode_count("1NNN"), 3);
+  ASSERT_EQ(profiler.address_count(0x204), 3);
+  ASSERT_EQ(profiler.address_count(0x206), 2);
+}
+
+TEST_F(ProfilerTest, WritesFoldedStacks) {
+  std::ostringstream out;
+  c.profiler().write_folded(out);
+  ASSERT_EQ(out.str(), "0x200 5\n0x200;0x206 4\n");
+}
+
+TEST_F(ProfilerTest, WritesJson) {
+  std::ostringstream out;
+  c.profiler().write_json(out);
+  ASSERT_NE(out.str().find("\"instructions\": 9"), std::string::npos);
+  ASSERT_NE(out.str().find("\"0x206\": {\"calls\": 2, \"cycles\": 4}"), std::string::npos);
+}
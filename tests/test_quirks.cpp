@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+
+#include "chip8.h"
+#include "quirks.h"
+#include "sdl.h"
+
+template <typename Quirks>
+class QuirksTest : public ::testing::Test {
+ public:
+  QuirksTest() : gfx{}, in{}, audio{}, c{gfx, in, audio} {}
+
+  EmptyGfx gfx;
+  EmptyInput in;
+  EmptyAudio audio;
+  Chip8<EmptyGfx, EmptyInput, EmptyAudio, Quirks> c;
+};
+
+using SuperChipTest = QuirksTest<quirks::SuperChip>;
+using XoChipTest = QuirksTest<quirks::XoChip>;
+
+TEST_F(SuperChipTest, SHRVxVy_8xy6) {
+  // LD Vx,NN then SHR Vx,[Vy]
+  c.load({0x6D, 0xFB, 0x8D, 0x06});
+
+  c.run(1);
+  ASSERT_EQ(c.program_counter(), 0x202);
+  ASSERT_EQ(c.registers(0xD), 0xFB);
+
+  c.run(1);
+  ASSERT_EQ(c.program_counter(), 0x204);
+  ASSERT_EQ(c.registers(0xD), 0xFB >> 1);
+  ASSERT_EQ(c.registers(0xF), 1);
+}
+
+TEST_F(SuperChipTest, SHLVxVy_8xyE) {
+  // LD Vx,NN then SHL Vx,[Vy]
+  c.load({0x6D, 0xCB, 0x8D, 0x0E});
+
+  c.run(1);
+  ASSERT_EQ(c.program_counter(), 0x202);
+  ASSERT_EQ(c.registers(0xD), 0xCB);
+
+  c.run(1);
+  ASSERT_EQ(c.program_counter(), 0x204);
+  ASSERT_EQ(c.registers(0xD), static_cast<uint8_t>(0xCB << 1));
+  ASSERT_EQ(c.registers(0xF), 1);
+}
+
+TEST_F(SuperChipTest, NoVFReset_8xy1) {
+  // LD VF,NN then OR V0,V1
+  c.load({0x6F, 0x05, 0x80, 0x11});
+
+  c.run(2);
+  ASSERT_EQ(c.registers(0xF), 0x05);
+}
+
+TEST_F(SuperChipTest, MemoryKeepsI_Fx55) {
+  // LD I,addr then LD [I],Vx
+  c.load({0xA3, 0x00, 0xF3, 0x55});
+
+  c.run(2);
+  ASSERT_EQ(c.index_register(), 0x300);
+}
+
+TEST_F(SuperChipTest, JumpUsesVx_Bxnn) {
+  // LD V3,NN then JP V3,addr
+  c.load({0x63, 0x10, 0xB3, 0x00});
+
+  c.run(2);
+  ASSERT_EQ(c.program_counter(), 0x300 + 0x10);
+}
+
+TEST_F(SuperChipTest, SpritesClip_Dxyn) {
+  // LD I,addr then LD V0,NN then DRW V0,V0,1: glyph "0" top row at (62, 62).
+  c.load({0xA0, 0x00, 0x60, 0x3E, 0xD0, 0x01});
+
+  c.run(3);
+  ASSERT_EQ(gfx.pixel(62, 30), true);
+  ASSERT_EQ(gfx.pixel(0, 30), false);
+}
+
+TEST_F(XoChipTest, SpritesWrap_Dxyn) {
+  // LD I,addr then LD V0,NN then DRW V0,V0,1: glyph "0" top row at (62, 62).
+  c.load({0xA0, 0x00, 0x60, 0x3E, 0xD0, 0x01});
+
+  c.run(3);
+  ASSERT_EQ(gfx.pixel(62, 30), true);
+  ASSERT_EQ(gfx.pixel(1, 30), true);
+}
+
+TEST_F(XoChipTest, NoVFReset_8xy3) {
+  // LD VF,NN then XOR V0,V1
+  c.load({0x6F, 0x05, 0x80, 0x13});
+
+  c.run(2);
+  ASSERT_EQ(c.registers(0xF), 0x05);
+}
+
+TEST_F(XoChipTest, LDAudioI_F002_LDPitchVx_Fx3A) {
+  // LD I,addr then LD AUDIO,[I] then LD V5,NN then LD PITCH,V5.
+  c.load({0xA2, 0x08, 0xF0, 0x02, 0x65, 0x70, 0xF5, 0x3A, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09,
+          0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10});
+  ASSERT_EQ(c.audio_pattern(0), 0xFF);
+  ASSERT_EQ(c.pitch(), 64);
+
+  c.run(2);
+  ASSERT_EQ(c.program_counter(), 0x204);
+  ASSERT_EQ(c.audio_pattern(0), 0x01);
+  ASSERT_EQ(c.audio_pattern(15), 0x10);
+
+  c.run(2);
+  ASSERT_EQ(c.program_counter(), 0x208);
+  ASSERT_EQ(c.pitch(), 0x70);
+}
+
+TEST_F(SuperChipTest, AudioOpcodesAreUnknown) {
+  c.load({0xF0, 0x02});
+  ASSERT_THROW(c.run(1), std::runtime_error);
+
+  c.load({0xF5, 0x3A});
+  ASSERT_THROW(c.run(1), std::runtime_error);
+}
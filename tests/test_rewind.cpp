@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "chip8.h"
+#include "rewind.h"
+#include "sdl.h"
+
+using MockedChip8 = Chip8<EmptyGfx, EmptyInput, EmptyAudio>;
+
+class RewindTest : public ::testing::Test {
+ public:
+  RewindTest() : gfx{}, in{}, audio{}, c{gfx, in, audio} {
+    // Draws random font glyphs at random positions forever.
+    c.load({0xC0, 0x3F, 0xC1, 0x1F, 0xC2, 0x0F, 0xF2, 0x29, 0xD0, 0x15, 0x12, 0x00});
+  }
+
+  // Run a frame worth of instructions and return its snapshot.
+  MockedChip8::Snapshot frame() {
+    c.run(10);
+    return c.snapshot();
+  }
+
+  EmptyGfx gfx;
+  EmptyInput in;
+  EmptyAudio audio;
+  MockedChip8 c;
+};
+
+TEST_F(RewindTest, StepsBackThroughKeyframes) {
+  Rewind<MockedChip8::Snapshot> rewind{1000, 1 << 20, 8};
+  std::vector<MockedChip8::Snapshot> frames;
+  for (int i = 0; i < 30; ++i) {
+    frames.push_back(frame());
+    rewind.push(frames.back());
+  }
+  ASSERT_EQ(rewind.frames(), 30);
+  ASSERT_EQ(rewind.stats().keyframes, 4);
+
+  MockedChip8::Snapshot snapshot;
+  for (int i = 28; i >= 0; --i) {
+    ASSERT_TRUE(rewind.step_back(snapshot));
+    ASSERT_EQ(snapshot, frames.at(i));
+  }
+  ASSERT_FALSE(rewind.step_back(snapshot));
+  ASSERT_EQ(rewind.frames(), 1);
+}
+
+TEST_F(RewindTest, ContinuesAfterStepBack) {
+  Rewind<MockedChip8::Snapshot> rewind{1000, 1 << 20, 4};
+  for (int i = 0; i < 10; ++i) {
+    rewind.push(frame());
+  }
+  MockedChip8::Snapshot snapshot;
+  ASSERT_TRUE(rewind.step_back(snapshot));
+  ASSERT_TRUE(rewind.step_back(snapshot));
+  c.restore(snapshot);
+
+  std::vector<MockedChip8::Snapshot> frames{snapshot};
+  for (int i = 0; i < 6; ++i) {
+    frames.push_back(frame());
+    rewind.push(frames.back());
+  }
+  for (int i = 5; i >= 0; --i) {
+    ASSERT_TRUE(rewind.step_back(snapshot));
+    ASSERT_EQ(snapshot, frames.at(i));
+  }
+}
+
+TEST_F(RewindTest, UnchangedFramesAreSmall) {
+  Rewind<MockedChip8::Snapshot> rewind{1000, 1 << 20, 60};
+  auto snapshot{frame()};
+  rewind.push(snapshot);
+  auto keyframe_bytes{rewind.stats().bytes};
+  ASSERT_LT(keyframe_bytes, sizeof(snapshot));
+
+  rewind.push(snapshot);
+  ASSERT_EQ(rewind.stats().bytes, keyframe_bytes + 4);
+}
+
+TEST_F(RewindTest, DropsOldestFrames) {
+  Rewind<MockedChip8::Snapshot> rewind{20, 1 << 20, 8};
+  for (int i = 0; i < 100; ++i) {
+    rewind.push(frame());
+    ASSERT_LE(rewind.frames(), 20);
+  }
+  ASSERT_GE(rewind.frames(), 12);
+
+  Rewind<MockedChip8::Snapshot> small{1000, 4096, 8};
+  for (int i = 0; i < 100; ++i) {
+    small.push(frame());
+  }
+  ASSERT_LE(small.stats().bytes, 4096);
+  ASSERT_GT(small.stats().mean_encode.count(), 0);
+
+  // Oldest frame left is still reachable.
+  MockedChip8::Snapshot snapshot;
+  while (small.step_back(snapshot)) {
+  }
+  ASSERT_EQ(small.frames(), 1);
+}
@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+
+#include "chip8.h"
+#include "rom_archive.h"
+#include "sdl.h"
+
+class RomArchiveTest : public ::testing::Test {
+ public:
+  RomArchiveTest() : path{std::filesystem::temp_directory_path() / "chip8_test_archive.c8a"} {}
+  ~RomArchiveTest() override { std::filesystem::remove(path); }
+
+  void write(const std::vector<std::vector<uint8_t>>& roms) {
+    std::ofstream file{path, std::ios::binary};
+    write_rom_archive(file, roms);
+  }
+
+  std::filesystem::path path;
+};
+
+TEST(Fnv1a, KnownValues) {
+  ASSERT_EQ(fnv1a({}), 0xCBF29CE484222325);
+  const std::vector<uint8_t> a{'a'};
+  ASSERT_EQ(fnv1a(a), 0xAF63DC4C8601EC8C);
+}
+
+TEST_F(RomArchiveTest, FindsRomsByHash) {
+  const std::vector<uint8_t> jump{0x12, 0x00};
+  const std::vector<uint8_t> load{0x60, 0x42, 0x12, 0x02};
+  const std::vector<uint8_t> missing{0x00, 0xE0};
+  write({jump, load, jump});
+
+  RomArchive archive{path.string()};
+  ASSERT_EQ(archive.size(), 2);
+  ASSERT_LT(archive.hash(0), archive.hash(1));
+
+  auto rom{archive.find(fnv1a(load))};
+  ASSERT_TRUE(rom.has_value());
+  ASSERT_TRUE(std::equal(rom->begin(), rom->end(), load.begin(), load.end()));
+  ASSERT_FALSE(archive.find(fnv1a(missing)).has_value());
+
+  // Loaded straight from the mapping.
+  EmptyGfx gfx;
+  EmptyInput in;
+  EmptyAudio audio;
+  Chip8<EmptyGfx, EmptyInput, EmptyAudio> c{gfx, in, audio};
+  c.load(*rom);
+  c.run(1);
+  ASSERT_EQ(c.registers(0), 0x42);
+}
+
+TEST(RomArchiveLayout, OffsetsFollowIndex) {
+  const std::vector<std::size_t> sizes{2, 4, 3};
+  // 16-byte header and 16-byte entry per ROM precede the data.
+  ASSERT_EQ(rom_offsets(sizes), (std::vector<uint32_t>{64, 66, 70}));
+}
+
+TEST(RomArchiveLayout, RejectsArchivePast4GiB) {
+  const std::size_t rom_size{std::size_t{1} << 31};
+  // Archive of two ROMs may end at the last 32-bit offset, but not past it.
+  const std::vector<std::size_t> fits{rom_size, rom_size - 49};
+  ASSERT_EQ(rom_offsets(fits).back(), 48 + rom_size);
+  const std::vector<std::size_t> too_large{rom_size, rom_size};
+  ASSERT_THROW(rom_offsets(too_large), std::runtime_error);
+}
+
+TEST(RomArchiveLayout, OffsetsOfUniqueRoms) {
+  const std::vector<std::vector<uint8_t>> roms{{0x12, 0x00}, {0x00, 0xE0, 0x12, 0x00}, {0x12, 0x00}};
+  // Two ROMs in the index, the duplicate stored once.
+  ASSERT_EQ(rom_archive_offsets(roms).size(), 2);
+  ASSERT_EQ(rom_archive_offsets(roms).front(), 48);
+}
+
+TEST(ParseRomHash, AcceptsHexDigits) {
+  ASSERT_EQ(parse_rom_hash("cbf29ce484222325"), 0xcbf29ce484222325);
+  ASSERT_EQ(parse_rom_hash("AF"), 0xAF);
+  ASSERT_THROW(parse_rom_hash(""), std::invalid_argument);
+  ASSERT_THROW(parse_rom_hash("0x12"), std::invalid_argument);
+  ASSERT_THROW(parse_rom_hash("12 "), std::invalid_argument);
+  ASSERT_THROW(parse_rom_hash("1cbf29ce484222325"), std::invalid_argument);
+}
+
+TEST_F(RomArchiveTest, RejectsInvalidFiles) {
+  ASSERT_THROW(RomArchive{path.string()}, std::runtime_error);
+
+  {
+    std::ofstream file{path, std::ios::binary};
+    file << "not a ROM archive, definitely not a ROM archive";
+  }
+  ASSERT_THROW(RomArchive{path.string()}, std::runtime_error);
+
+  write({{0x12, 0x00}});
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+  ASSERT_THROW(RomArchive{path.string()}, std::runtime_error);
+}
@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+#include "chip8.h"
+#include "savestate.h"
+#include "sdl.h"
+
+using MockedChip8 = Chip8<EmptyGfx, EmptyInput, EmptyAudio>;
+
+namespace {
+
+// Draws random font glyphs at random positions forever.
+const std::vector<uint8_t> random_sprites{
+    0xC0, 0x3F,  // RND V0,3F
+    0xC1, 0x1F,  // RND V1,1F
+    0xC2, 0x0F,  // RND V2,0F
+    0xF2, 0x29,  // LD F,V2
+    0xD0, 0x15,  // DRW V0,V1,5
+    0x12, 0x00,  // JP 0x200
+};
+
+}  // namespace
+
+class SaveStateTest : public ::testing::TestWithParam<Engine> {
+ public:
+  SaveStateTest() : gfx{}, in{}, audio{}, c{gfx, in, audio} { c.set_engine(GetParam()); }
+
+  EmptyGfx gfx;
+  EmptyInput in;
+  EmptyAudio audio;
+  MockedChip8 c;
+};
+
+INSTANTIATE_TEST_SUITE_P(Engines, SaveStateTest, ::testing::Values(Engine::interpreter, Engine::block));
+
+TEST_P(SaveStateTest, RestoreReplaysSameRun) {
+  c.seed(7);
+  c.load(random_sprites);
+  c.run(100);
+
+  auto saved{c.snapshot()};
+  c.run(500);
+  auto after{c.snapshot()};
+
+  c.restore(saved);
+  ASSERT_EQ(c.snapshot(), saved);
+  c.run(500);
+  ASSERT_EQ(c.snapshot(), after);
+  ASSERT_EQ(gfx.rows(), after.framebuffer);
+}
+
+TEST_P(SaveStateTest, RestoreDropsStaleCode) {
+  // LD V0,11 then ADD V0,11 then LD I,addr then LD [I],V0 rewriting the first
+  // instruction to LD V0,22, then JP 0x200.
+  c.load({0x60, 0x11, 0x70, 0x11, 0xA2, 0x01, 0xF0, 0x55, 0x12, 0x00});
+  auto saved{c.snapshot()};
+  c.run(6);
+  ASSERT_EQ(c.ram(0x201), 0x22);
+  ASSERT_EQ(c.registers(0), 0x22);
+
+  c.restore(saved);
+  c.run(1);
+  ASSERT_EQ(c.ram(0x201), 0x11);
+  ASSERT_EQ(c.registers(0), 0x11);
+}
+
+TEST_P(SaveStateTest, CopyContinuesIndependently) {
+  c.seed(7);
+  c.load(random_sprites);
+  c.run(100);
+
+  MockedChip8 copy{c};
+  ASSERT_EQ(copy.engine(), c.engine());
+  ASSERT_EQ(copy.program_counter(), c.program_counter());
+  copy.run(6);
+  ASSERT_EQ(copy.program_counter(), c.program_counter());
+  ASSERT_NE(copy.registers(0) + copy.registers(1) * 0x100, c.registers(0) + c.registers(1) * 0x100);
+}
+
+TEST_P(SaveStateTest, AssignmentCopiesEngine) {
+  c.load(random_sprites);
+  c.run(10);
+
+  EmptyGfx other_gfx;
+  MockedChip8 other{other_gfx, in, audio};
+  other.set_engine(GetParam() == Engine::block ? Engine::interpreter : Engine::block);
+  other = c;
+  ASSERT_EQ(other.engine(), c.engine());
+  ASSERT_EQ(other.snapshot(), c.snapshot());
+}
+
+TEST(SaveStateFile, RoundTrip) {
+  EmptyGfx gfx;
+  EmptyInput in;
+  EmptyAudio audio;
+  MockedChip8 c{gfx, in, audio};
+  c.seed(7);
+  c.load(random_sprites);
+  c.run(100);
+  auto saved{c.snapshot()};
+
+  std::stringstream file;
+  savestate::save(file, saved);
+  // RAM, registers, timers, I, PC, SP, stack, RNG, cycles, audio pattern,
+  // pitch and framebuffer, without padding.
+  ASSERT_EQ(file.str().size(), 12 + 4096 + 16 + 2 + 4 + 1 + 32 + 8 + 8 + 16 + 1 + 256);
+
+  MockedChip8::Snapshot loaded{};
+  savestate::load(file, loaded);
+  ASSERT_EQ(loaded, saved);
+}
+
+TEST(SaveStateFile, StoresFieldsLittleEndian) {
+  MockedChip8::Snapshot snapshot{};
+  snapshot.machine.ir = 0x0ABC;
+  snapshot.machine.cycles = 0x0102030405060708;
+  snapshot.framebuffer.back() = 0x8000000000000001;
+  std::stringstream file;
+  savestate::save(file, snapshot);
+  const auto bytes{file.str()};
+
+  // I follows the header, RAM, registers and both timers.
+  const std::size_t ir{12 + 4096 + 16 + 2};
+  ASSERT_EQ(bytes.substr(ir, 2), std::string("\xBC\x0A"));
+  // Cycles follow PC, SP, stack and RNG.
+  const std::size_t cycles{ir + 2 + 2 + 1 + 32 + 8};
+  ASSERT_EQ(bytes.substr(cycles, 8), std::string("\x08\x07\x06\x05\x04\x03\x02\x01"));
+  ASSERT_EQ(bytes.substr(bytes.size() - 8), std::string("\x01\x00\x00\x00\x00\x00\x00\x80", 8));
+}
+
+TEST(SaveStateFile, RejectsInvalidFiles) {
+  MockedChip8::Snapshot snapshot{};
+  std::stringstream file;
+  savestate::save(file, snapshot);
+  const auto valid{file.str()};
+
+  std::stringstream not_state{"not a save state, definitely not a save state"};
+  ASSERT_THROW(savestate::load(not_state, snapshot), std::runtime_error);
+
+  auto other_version{valid};
+  other_version[4] = 0x7F;
+  std::stringstream other_version_file{other_version};
+  ASSERT_THROW(savestate::load(other_version_file, snapshot), std::runtime_error);
+
+  std::stringstream truncated{valid.substr(0, valid.size() - 1)};
+  ASSERT_THROW(savestate::load(truncated, snapshot), std::runtime_error);
+}
@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#include "thread_pool.h"
+
+TEST(ThreadPool, RunsAllTasks) {
+  ThreadPool pool{4};
+  ASSERT_EQ(pool.size(), 4);
+
+  std::vector<int> results(1000, 0);
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    pool.submit([&results, i]() { results[i] = static_cast<int>(i) * 2; });
+  }
+  pool.wait();
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    ASSERT_EQ(results[i], static_cast<int>(i) * 2);
+  }
+
+  // Reusable after wait().
+  std::atomic<int> count{0};
+  for (int i = 0; i < 100; ++i) {
+    pool.submit([&count]() { ++count; });
+  }
+  pool.wait();
+  ASSERT_EQ(count, 100);
+}
+
+TEST(ThreadPool, TasksCanSubmitTasks) {
+  ThreadPool pool{2};
+  std::atomic<int> count{0};
+  for (int i = 0; i < 10; ++i) {
+    pool.submit([&pool, &count]() {
+      for (int j = 0; j < 10; ++j) {
+        pool.submit([&count]() { ++count; });
+      }
+    });
+  }
+  pool.wait();
+  ASSERT_EQ(count, 100);
+}
+
+TEST(ThreadPool, IdleWorkersSteal) {
+  ThreadPool pool{2};
+  std::atomic<bool> started{false};
+  std::atomic<bool> release{false};
+  std::atomic<int> count{0};
+  // Block one worker until every other task ran, half of which are queued to it.
+  pool.submit([&]() {
+    started = true;
+    while (!release) {
+      std::this_thread::yield();
+    }
+  });
+  while (!started) {
+    std::this_thread::yield();
+  }
+  for (int i = 0; i < 10; ++i) {
+    pool.submit([&]() {
+      if (++count == 10) {
+        release = true;
+      }
+    });
+  }
+  pool.wait();
+  ASSERT_EQ(count, 10);
+  ASSERT_GE(pool.steals(), 5);
+}
+
+TEST(ThreadPool, DestructorFinishesTasks) {
+  std::atomic<int> count{0};
+  {
+    ThreadPool pool{3};
+    for (int i = 0; i < 50; ++i) {
+      pool.submit([&count]() {
+        std::this_thread::sleep_for(std::chrono::microseconds(10));
+        ++count;
+      });
+    }
+  }
+  ASSERT_EQ(count, 50);
+}
@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+#include "timer.h"
+
+using namespace std::chrono_literals;
+
+namespace {
+
+// Simulated time, advanced only by the test and by sleeping.
+struct FakeTime {
+  Pacer::Clock::time_point now{};
+  // Number of sleep_until() calls.
+  int sleeps{0};
+
+  TimeSource source() {
+    return {[this]() { return now; },
+            [this](Pacer::Clock::time_point time) {
+              ++sleeps;
+              now = std::max(now, time);
+            }};
+  }
+};
+
+}  // namespace
+
+TEST(PacerTest, OnScheduleSleepsUntilEveryTick) {
+  FakeTime time;
+  Pacer pacer{1ms, Overrun::catch_up, time.source()};
+
+  for (int i = 0; i < 3; ++i) {
+    pacer.wait();
+  }
+  ASSERT_EQ(time.now, Pacer::Clock::time_point{3ms});
+  ASSERT_EQ(time.sleeps, 3);
+  auto stats{pacer.stats()};
+  ASSERT_EQ(stats.ticks, 3);
+  ASSERT_EQ(stats.overruns, 0);
+  ASSERT_EQ(stats.max_jitter, 0ms);
+}
+
+TEST(PacerTest, SkipDropsMissedTicks) {
+  FakeTime time;
+  Pacer pacer{1ms, Overrun::skip, time.source()};
+  time.now += 10500us;
+
+  // Tick due at 1 ms is 9.5 ms late, ticks due at 2 to 10 ms are dropped.
+  pacer.wait();
+  auto stats{pacer.stats()};
+  ASSERT_EQ(time.sleeps, 0);
+  ASSERT_EQ(stats.ticks, 1);
+  ASSERT_EQ(stats.overruns, 1);
+  ASSERT_EQ(stats.skipped, 9);
+  ASSERT_EQ(stats.max_jitter, 9500us);
+
+  // Back on schedule, the next tick is at 11 ms.
+  pacer.wait();
+  ASSERT_EQ(time.sleeps, 1);
+  ASSERT_EQ(time.now, Pacer::Clock::time_point{11ms});
+  ASSERT_EQ(pacer.stats().ticks, 2);
+  ASSERT_EQ(pacer.stats().skipped, 9);
+}
+
+TEST(PacerTest, CatchUpRunsMissedTicks) {
+  FakeTime time;
+  Pacer pacer{1ms, Overrun::catch_up, time.source()};
+  time.now += 10500us;
+
+  // Ticks due at 1 to 10 ms run back to back, all but the last an interval
+  // or more late.
+  for (int i = 0; i < 10; ++i) {
+    pacer.wait();
+  }
+  auto stats{pacer.stats()};
+  ASSERT_EQ(time.sleeps, 0);
+  ASSERT_EQ(stats.ticks, 10);
+  ASSERT_EQ(stats.overruns, 9);
+  ASSERT_EQ(stats.skipped, 0);
+  ASSERT_EQ(stats.max_jitter, 9500us);
+  ASSERT_EQ(stats.mean_jitter, 5ms);
+
+  pacer.wait();
+  ASSERT_EQ(time.sleeps, 1);
+  ASSERT_EQ(time.now, Pacer::Clock::time_point{11ms});
+}
+
+TEST(PacerTest, SetIntervalRestartsSchedule) {
+  FakeTime time;
+  Pacer pacer{1ms, Overrun::catch_up, time.source()};
+  time.now += 5ms;
+
+  pacer.set_interval(2ms);
+  ASSERT_EQ(pacer.next_tick(), Pacer::Clock::time_point{7ms});
+  pacer.wait();
+  ASSERT_EQ(time.now, Pacer::Clock::time_point{7ms});
+  ASSERT_EQ(pacer.stats().overruns, 0);
+}
@@ -0,0 +1,150 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <vector>
+
+#include "vec_env.h"
+
+namespace {
+
+// Observation buffer with the alignment VecEnv requires.
+class Observations {
+ public:
+  explicit Observations(std::size_t envs) : blocks_(envs) {}
+
+  std::span<uint8_t> span() {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    return {reinterpret_cast<uint8_t*>(blocks_.data()), blocks_.size() * VecEnv::observation_size};
+  }
+
+  uint8_t pixel(std::size_t env, std::size_t x, std::size_t y) {
+    return span()[env * VecEnv::observation_size + y * 64 + x];
+  }
+
+ private:
+  struct alignas(VecEnv::observation_alignment) Block {
+    std::array<uint8_t, VecEnv::observation_size> pixels;
+  };
+
+  std::vector<Block> blocks_;
+};
+
+// Increments RAM at 0x300 once per four cycles.
+const std::vector<uint8_t> counter{0xA3, 0x00, 0x70, 0x01, 0xF0, 0x55, 0x12, 0x00};
+
+}  // namespace
+
+TEST(VecEnv, WritesFramebufferToObservations) {
+  // Draw font 0 at (0, 0) when key 1 is pressed, then loop.
+  std::vector<uint8_t> game{0x61, 0x01, 0xE1, 0x9E, 0x12, 0x02, 0x60, 0x00, 0xF0, 0x29, 0xD0, 0x05, 0x12, 0x0C};
+  VecEnv env{game, {.envs = 2, .threads = 2}};
+  Observations observations{env.size()};
+  std::vector<uint16_t> actions{0x0002, 0x0000};
+  std::vector<float> rewards(env.size());
+  std::vector<uint8_t> done(env.size());
+
+  env.reset(0, observations.span());
+  env.step(actions, observations.span(), rewards, done);
+  // F0 90 90 90 F0.
+  for (std::size_t x = 0; x < 4; ++x) {
+    ASSERT_EQ(observations.pixel(0, x, 0), 1);
+    ASSERT_EQ(observations.pixel(0, x, 4), 1);
+    ASSERT_EQ(observations.pixel(1, x, 0), 0);
+  }
+  ASSERT_EQ(observations.pixel(0, 4, 0), 0);
+  ASSERT_EQ(observations.pixel(0, 0, 1), 1);
+  ASSERT_EQ(observations.pixel(0, 1, 1), 0);
+  ASSERT_EQ(observations.pixel(0, 3, 1), 1);
+  ASSERT_EQ(done, (std::vector<uint8_t>{0, 0}));
+  ASSERT_EQ(env.steps(), 2);
+}
+
+TEST(VecEnv, RewardsFromProbes) {
+  VecEnv env{counter, {.envs = 3, .frame_skip = 3, .cycles_per_frame = 4, .rewards = {{0x300, 0.5F}}, .threads = 2}};
+  Observations observations{env.size()};
+  std::vector<uint16_t> actions(env.size());
+  std::vector<float> rewards(env.size());
+  std::vector<uint8_t> done(env.size());
+
+  env.reset(0, observations.span());
+  for (int i = 0; i < 10; ++i) {
+    env.step(actions, observations.span(), rewards, done);
+    ASSERT_EQ(rewards, (std::vector<float>{1.5F, 1.5F, 1.5F}));
+  }
+  ASSERT_GT(env.steps_per_second(), 0);
+}
+
+TEST(VecEnv, EpisodesEndAndRestart) {
+  VecEnv env{counter, {.envs = 1, .frame_skip = 2, .cycles_per_frame = 4, .rewards = {{0x300}}, .max_frames = 5}};
+  Observations observations{env.size()};
+  std::vector<uint16_t> actions(env.size());
+  std::vector<float> rewards(env.size());
+  std::vector<uint8_t> done(env.size());
+
+  env.reset(0, observations.span());
+  std::vector<uint8_t> expected_done{0, 0, 1, 0, 0, 1};
+  // The last step of an episode stops at max_frames.
+  std::vector<float> expected_rewards{2, 2, 1, 2, 2, 1};
+  for (std::size_t i = 0; i < expected_done.size(); ++i) {
+    env.step(actions, observations.span(), rewards, done);
+    ASSERT_EQ(done[0], expected_done[i]);
+    ASSERT_EQ(rewards[0], expected_rewards[i]);
+  }
+
+  // Done probe.
+  VecEnv probed{counter, {.envs = 1, .frame_skip = 2, .cycles_per_frame = 4, .done = {{0x300, 3}}}};
+  probed.reset(0, observations.span());
+  expected_done = {0, 1, 0, 1};
+  for (auto expected : expected_done) {
+    probed.step(actions, observations.span(), rewards, done);
+    ASSERT_EQ(done[0], expected);
+  }
+
+  // Fault.
+  VecEnv faulting{std::vector<uint8_t>{0xFF, 0xFF}, {.envs = 1}};
+  faulting.reset(0, observations.span());
+  faulting.step(actions, observations.span(), rewards, done);
+  ASSERT_EQ(done[0], 1);
+}
+
+TEST(VecEnv, SameResultsWithAnyThreadCount) {
+  // Random sprites.
+  std::vector<uint8_t> game{0xC0, 0x3F, 0xC1, 0x1F, 0xC2, 0x0F, 0xF2, 0x29, 0xD0, 0x15, 0x12, 0x00};
+  VecEnv single{game, {.envs = 9, .threads = 1}};
+  VecEnv multi{game, {.envs = 9, .threads = 4}};
+  Observations single_observations{single.size()};
+  Observations multi_observations{multi.size()};
+  std::vector<uint16_t> actions(single.size());
+  std::vector<float> rewards(single.size());
+  std::vector<uint8_t> done(single.size());
+
+  single.reset(7, single_observations.span());
+  multi.reset(7, multi_observations.span());
+  for (int i = 0; i < 20; ++i) {
+    single.step(actions, single_observations.span(), rewards, done);
+    multi.step(actions, multi_observations.span(), rewards, done);
+    ASSERT_TRUE(std::ranges::equal(single_observations.span(), multi_observations.span()));
+  }
+  // Environments are seeded differently.
+  auto first{single_observations.span().first(VecEnv::observation_size)};
+  auto second{single_observations.span().subspan(VecEnv::observation_size, VecEnv::observation_size)};
+  ASSERT_FALSE(std::ranges::equal(first, second));
+}
+
+TEST(VecEnv, RejectsInvalidArguments) {
+  ASSERT_THROW((VecEnv{counter, {.envs = 0}}), std::invalid_argument);
+  ASSERT_THROW((VecEnv{counter, {.rewards = {{0x1000}}}}), std::invalid_argument);
+
+  VecEnv env{counter, {.envs = 2}};
+  Observations observations{3};
+  std::vector<uint16_t> actions(env.size());
+  std::vector<float> rewards(env.size());
+  std::vector<uint8_t> done(env.size());
+  ASSERT_THROW(env.reset(0, observations.span()), std::invalid_argument);
+  ASSERT_THROW(env.reset(0, observations.span().subspan(1, 2 * VecEnv::observation_size)), std::invalid_argument);
+  ASSERT_THROW(env.step(actions, observations.span().first(2 * VecEnv::observation_size), rewards,
+                        std::span<uint8_t>{done}.first(1)),
+               std::invalid_argument);
+}